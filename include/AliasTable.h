@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace VKRT {
+
+// Vose's alias method over any element with selectionProbability, aliasProbability and alias
+// members. selectionProbability holds each element's weight on entry and is normalized on return,
+// shaders then pick an element proportionally to its weight with two uniform numbers
+template <typename Element>
+void BuildAliasTable(std::vector<Element>& elements, float totalWeight) {
+    const size_t elementCount = elements.size();
+    std::vector<float> scaledProbabilities(elementCount);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (uint32_t index = 0; index < elementCount; ++index) {
+        elements[index].selectionProbability /= totalWeight;
+        elements[index].aliasProbability = 1.0f;
+        elements[index].alias = index;
+        scaledProbabilities[index] = elements[index].selectionProbability * elementCount;
+        if (scaledProbabilities[index] < 1.0f) {
+            small.push_back(index);
+        } else {
+            large.push_back(index);
+        }
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const uint32_t lessIndex = small.back();
+        small.pop_back();
+        const uint32_t moreIndex = large.back();
+        large.pop_back();
+
+        elements[lessIndex].aliasProbability = scaledProbabilities[lessIndex];
+        elements[lessIndex].alias = moreIndex;
+        scaledProbabilities[moreIndex] =
+            (scaledProbabilities[moreIndex] + scaledProbabilities[lessIndex]) - 1.0f;
+        if (scaledProbabilities[moreIndex] < 1.0f) {
+            small.push_back(moreIndex);
+        } else {
+            large.push_back(moreIndex);
+        }
+    }
+
+    // Whatever is left is 1 up to rounding error
+    for (uint32_t index : small) {
+        elements[index].aliasProbability = 1.0f;
+    }
+    for (uint32_t index : large) {
+        elements[index].aliasProbability = 1.0f;
+    }
+}
+
+}  // namespace VKRT
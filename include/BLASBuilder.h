@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Mesh;
+class VulkanBuffer;
+
+class BLASBuilder : public RefCountPtr {
+public:
+    BLASBuilder(ScopedRefPtr<Context> context);
+
+    void Enqueue(Mesh* mesh);
+    void Flush();
+
+    bool HasPendingBuilds() const { return !mPendingMeshes.empty(); }
+
+    ~BLASBuilder();
+
+private:
+    void EnsureScratchCapacity(vk::DeviceSize size);
+    void Compact(const std::vector<Mesh*>& meshes);
+
+    ScopedRefPtr<Context> mContext;
+    std::vector<ScopedRefPtr<Mesh>> mPendingMeshes;
+    ScopedRefPtr<VulkanBuffer> mScratchBuffer;
+
+    static constexpr vk::DeviceSize MaxScratchArenaSize = 256ull * 1024ull * 1024ull;
+};
+
+}  // namespace VKRT
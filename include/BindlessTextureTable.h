@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Texture;
+
+// One update-after-bind, partially bound array of sampled images shared by every frame, bound as
+// its own descriptor set. Slots are handed out from a free list and written in place, a removed
+// slot is only reused once no frame in flight can still be sampling it
+class BindlessTextureTable : public RefCountPtr {
+public:
+    BindlessTextureTable(ScopedRefPtr<Context> context);
+
+    uint32_t Add(ScopedRefPtr<Texture> texture);
+    void Remove(uint32_t slot);
+
+    // Called once per frame after the frame slot's fence has been waited on
+    void BeginFrame(uint32_t framesInFlight);
+
+    uint32_t GetCapacity() const { return mCapacity; }
+    const vk::DescriptorSetLayout& GetDescriptorLayout() const { return mDescriptorLayout; }
+    const vk::DescriptorSet& GetDescriptorSet() const { return mDescriptorSet; }
+
+    ~BindlessTextureTable();
+
+private:
+    struct RetiredSlot {
+        uint32_t slot;
+        uint64_t frame;
+    };
+
+    ScopedRefPtr<Context> mContext;
+    uint32_t mCapacity;
+    vk::DescriptorSetLayout mDescriptorLayout;
+    vk::DescriptorPool mDescriptorPool;
+    vk::DescriptorSet mDescriptorSet;
+
+    std::vector<ScopedRefPtr<Texture>> mTextures;
+    std::vector<uint32_t> mFreeSlots;
+    std::vector<RetiredSlot> mRetiredSlots;
+    uint64_t mFrameNumber;
+
+    static constexpr uint32_t MaxCapacity = 65536;
+};
+
+}  // namespace VKRT
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Pipeline.h"
+#include "RefCountPtr.h"
+#include "ResourceLoader.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+
+// Single compute shader with one descriptor set, used by the image passes that run after tracing
+class ComputePipeline : public RefCountPtr {
+public:
+    // Matches ComputeWorkgroupSize in definitions.glsl, every pass uses square workgroups
+    static constexpr uint32_t WorkgroupSize = 8;
+
+    ComputePipeline(
+        ScopedRefPtr<Context> context,
+        const std::vector<Pipeline::Descriptor>& descriptors,
+        Resource::Id shaderId,
+        uint32_t pushConstantSize = 0);
+
+    const std::vector<vk::DescriptorPoolSize>& GetDescriptorSizes() const {
+        return mDescriptorSizes;
+    }
+    const vk::DescriptorSetLayout& GetDescriptorLayout() const { return mDescriptorLayout; }
+    const vk::PipelineLayout& GetPipelineLayout() const { return mLayout; }
+    const vk::Pipeline& GetPipelineHandle() const { return mPipeline; }
+
+    // What one binding of a set points at, images fill image and buffers fill buffer, matching
+    // the type the binding was declared with
+    struct Binding {
+        vk::DescriptorImageInfo image;
+        vk::DescriptorBufferInfo buffer;
+    };
+    // Allocates a set from a pool of its own and writes one binding per descriptor, for passes
+    // whose resources never change. The pools live as long as the pipeline
+    vk::DescriptorSet CreateDescriptorSet(const std::vector<Binding>& bindings);
+
+    // Binds the pipeline and its set and covers width x height with workgroups
+    void Dispatch(
+        vk::CommandBuffer& commandBuffer,
+        vk::DescriptorSet descriptorSet,
+        uint32_t width,
+        uint32_t height,
+        const void* pushConstants = nullptr);
+
+    ~ComputePipeline();
+
+private:
+    ScopedRefPtr<Context> mContext;
+    vk::DescriptorSetLayout mDescriptorLayout;
+    std::vector<vk::DescriptorType> mDescriptorTypes;
+    std::vector<vk::DescriptorPoolSize> mDescriptorSizes;
+    std::vector<vk::DescriptorPool> mDescriptorPools;
+    vk::PipelineLayout mLayout;
+    vk::Pipeline mPipeline;
+    vk::ShaderModule mShader;
+    uint32_t mPushConstantSize;
+};
+
+}  // namespace VKRT
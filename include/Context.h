@@ -3,11 +3,13 @@
 #include <string>
 #include <vector>
 
+#include "BLASBuilder.h"
 #include "Device.h"
 #include "Instance.h"
 #include "RefCountPtr.h"
 #include "Result.h"
 #include "Swapchain.h"
+#include "UploadManager.h"
 #include "VulkanBase.h"
 #include "Window.h"
 
@@ -25,6 +27,8 @@ public:
     const vk::SurfaceKHR& GetSurface() { return mSurface; }
     ScopedRefPtr<Device> GetDevice() { return mDevice; }
     ScopedRefPtr<Swapchain> GetSwapchain() { return mSwapchain; }
+    ScopedRefPtr<BLASBuilder> GetBLASBuilder() { return mBLASBuilder; }
+    ScopedRefPtr<UploadManager> GetUploadManager() { return mUploadManager; }
 
     void Destroy();
 
@@ -36,6 +40,8 @@ private:
     ScopedRefPtr<Instance> mInstance;
     ScopedRefPtr<Device> mDevice;
     ScopedRefPtr<Swapchain> mSwapchain;
+    ScopedRefPtr<BLASBuilder> mBLASBuilder;
+    ScopedRefPtr<UploadManager> mUploadManager;
 };
 
 }  // namespace VKRT
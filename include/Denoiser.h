@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ComputePipeline.h"
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Texture;
+
+// Edge-aware spatiotemporal filter for realtime mode, after SVGF (Schied et al. 2017). The raygen
+// shader writes the AOVs owned here next to its accumulation image, Denoise then estimates the
+// per-pixel variance and runs a few a-trous wavelet iterations over the demodulated illumination
+class Denoiser : public RefCountPtr {
+public:
+    // Accumulation, normal/depth and moments alternate between two images every realtime frame so
+    // the raygen shader can reproject last frame's while writing the current one
+    static constexpr uint32_t HistoryCount = 2;
+
+    Denoiser(
+        ScopedRefPtr<Context> context,
+        const std::array<ScopedRefPtr<Texture>, HistoryCount>& radianceTextures);
+
+    ScopedRefPtr<Texture> GetAlbedoTexture() const { return mAlbedoTexture; }
+    ScopedRefPtr<Texture> GetNormalDepthTexture(uint32_t historyIndex) const {
+        return mNormalDepthTextures[historyIndex];
+    }
+    ScopedRefPtr<Texture> GetMomentsTexture(uint32_t historyIndex) const {
+        return mMomentsTextures[historyIndex];
+    }
+    // Filtered radiance, valid once Denoise has been recorded
+    ScopedRefPtr<Texture> GetOutputTexture() const { return mOutputTexture; }
+
+    // Filters the images the raygen shader wrote at historyIndex, expects those writes to be
+    // visible to compute reads
+    void Denoise(vk::CommandBuffer& commandBuffer, uint32_t historyIndex);
+
+    ~Denoiser();
+
+private:
+    // Mirrors AtrousConstants in denoiseAtrous.comp
+    struct AtrousConstants {
+        int32_t stepSize;
+        uint32_t modulate;
+    };
+
+    void CreateDescriptors();
+
+    ScopedRefPtr<Context> mContext;
+    uint32_t mWidth, mHeight;
+
+    std::array<ScopedRefPtr<Texture>, HistoryCount> mRadianceTextures;
+    ScopedRefPtr<Texture> mAlbedoTexture;
+    std::array<ScopedRefPtr<Texture>, HistoryCount> mNormalDepthTextures;
+    std::array<ScopedRefPtr<Texture>, HistoryCount> mMomentsTextures;
+    // Iterations ping-pong between these, the last one writes the output
+    ScopedRefPtr<Texture> mPingTexture;
+    ScopedRefPtr<Texture> mPongTexture;
+    ScopedRefPtr<Texture> mOutputTexture;
+
+    ScopedRefPtr<ComputePipeline> mVariancePipeline;
+    ScopedRefPtr<ComputePipeline> mAtrousPipeline;
+    vk::DescriptorPool mDescriptorPool;
+    // Every image is fixed, so the sets are written once per history index and shared by all
+    // frames
+    struct PassSets {
+        vk::DescriptorSet variance;
+        vk::DescriptorSet pingToPong;
+        vk::DescriptorSet pongToPing;
+        vk::DescriptorSet pingToOutput;
+    };
+    std::array<PassSets, HistoryCount> mPassSets;
+
+    static constexpr uint32_t AtrousIterations = 5;
+};
+
+}  // namespace VKRT
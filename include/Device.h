@@ -2,6 +2,7 @@
 
 #include <memory>
 
+#include "MemoryAllocator.h"
 #include "RefCountPtr.h"
 #include "Result.h"
 #include "VulkanBase.h"
@@ -25,30 +26,47 @@ public:
 
     void SetContext(ScopedRefPtr<Context> context);
 
-    // Memory handling
-    vk::DeviceMemory AllocateMemory(
+    // Memory handling, resources are suballocated from shared blocks, bind at allocation.offset.
+    // memoryFlags are required, preferredMemoryFlags only break ties between valid types.
+    // minAlignment raises the offset alignment for buffers whose device address has stricter
+    // rules than their memory requirements, e.g. shader binding tables
+    MemoryAllocation AllocateBufferMemory(
+        const vk::Buffer& buffer,
         const vk::MemoryPropertyFlags& memoryFlags,
-        const vk::MemoryRequirements memoryRequirements,
-        const vk::MemoryAllocateFlags& memoryAllocateFlags = {});
+        const vk::MemoryAllocateFlags& memoryAllocateFlags = {},
+        const vk::MemoryPropertyFlags& preferredMemoryFlags = {},
+        vk::DeviceSize minAlignment = 1);
+    MemoryAllocation AllocateImageMemory(
+        const vk::Image& image,
+        const vk::MemoryPropertyFlags& memoryFlags);
+    void FreeMemory(const MemoryAllocation& allocation);
 
     ScopedRefPtr<VulkanBuffer> CreateBuffer(
         const vk::DeviceSize& size,
         const vk::BufferUsageFlags& usageFlags,
         const vk::MemoryPropertyFlags& memoryFlags,
-        const vk::MemoryAllocateFlags& memoryAllocateFlags = {});
+        const vk::MemoryAllocateFlags& memoryAllocateFlags = {},
+        const vk::MemoryPropertyFlags& preferredMemoryFlags = {});
 
     vk::CommandBuffer CreateCommandBuffer();
     void SubmitCommand(const vk::CommandBuffer& commandBuffer, const vk::Fence& fence);
     void SubmitCommandAndFlush(const vk::CommandBuffer& commandBuffer);
     void DestroyCommand(vk::CommandBuffer& commandBuffer);
 
-    vk::Fence CreateFence();
+    vk::Fence CreateFence(bool signaled = false);
     void WaitForFence(vk::Fence& fence);
     void DestroyFence(vk::Fence& fence);
 
     vk::Device& GetLogicalDevice() { return mLogicalDevice; }
     vk::DispatchLoaderDynamic& GetDispatcher() { return mDispatcher; }
     const vk::Queue& GetQueue() { return mGraphicsQueue; }
+    // Falls back to the graphics queue when the device has no transfer only family
+    const vk::Queue& GetTransferQueue() { return mTransferQueue; }
+    uint32_t GetGraphicsQueueFamilyIndex() const { return mGraphicsQueueFamilyIndex; }
+    uint32_t GetTransferQueueFamilyIndex() const { return mTransferQueueFamilyIndex; }
+    bool HasDedicatedTransferQueue() const {
+        return mTransferQueueFamilyIndex != mGraphicsQueueFamilyIndex;
+    }
 
     struct SwapchainCapabilities {
         vk::SurfaceCapabilitiesKHR surfaceCapabilities;
@@ -58,17 +76,29 @@ public:
     SwapchainCapabilities GetSwapchainCapabilities(vk::SurfaceKHR surface);
 
     vk::PhysicalDeviceProperties GetDeviceProperties();
+    vk::FormatProperties GetFormatProperties(vk::Format format);
     vk::PhysicalDeviceRayTracingPipelinePropertiesKHR GetRayTracingProperties();
+    vk::PhysicalDeviceAccelerationStructurePropertiesKHR GetAccelerationStructureProperties();
+    vk::PhysicalDeviceDescriptorIndexingProperties GetDescriptorIndexingProperties();
 
     ~Device();
 
 private:
+    uint32_t FindMemoryType(
+        const vk::MemoryPropertyFlags& requiredFlags,
+        const vk::MemoryPropertyFlags& preferredFlags,
+        const vk::MemoryRequirements& memoryRequirements);
+
     ScopedRefPtr<Context> mContext;
     vk::PhysicalDevice mPhysicalDevice;
     vk::Device mLogicalDevice;
     vk::Queue mGraphicsQueue;
+    vk::Queue mTransferQueue;
+    uint32_t mGraphicsQueueFamilyIndex;
+    uint32_t mTransferQueueFamilyIndex;
     vk::CommandPool mCommandPool;
     vk::DispatchLoaderDynamic mDispatcher;
+    std::unique_ptr<MemoryAllocator> mMemoryAllocator;
 };
 
 }  // namespace VKRT
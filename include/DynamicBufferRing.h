@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class VulkanBuffer;
+
+// Persistently mapped buffer split in one region per frame in flight. Per frame constants are
+// bump allocated from the current frame's region and bound through dynamic offsets, so writing
+// them costs no driver calls. A region is only reused once its frame's fence has signaled
+class DynamicBufferRing : public RefCountPtr {
+public:
+    DynamicBufferRing(
+        ScopedRefPtr<Context> context,
+        vk::DeviceSize frameCapacity,
+        uint32_t frameCount,
+        const vk::BufferUsageFlags& usageFlags);
+
+    void BeginFrame(uint32_t frameIndex);
+
+    struct Allocation {
+        uint8_t* data;
+        uint32_t offset;
+    };
+    Allocation Allocate(vk::DeviceSize size);
+
+    template <typename T>
+    uint32_t Push(const T& value) {
+        const Allocation allocation = Allocate(sizeof(T));
+        std::copy_n(reinterpret_cast<const uint8_t*>(&value), sizeof(T), allocation.data);
+        return allocation.offset;
+    }
+
+    // For dynamic descriptors, the dynamic offset is added on top of the base offset 0
+    vk::DescriptorBufferInfo GetDescriptorInfo(vk::DeviceSize range) const;
+
+    ~DynamicBufferRing();
+
+private:
+    ScopedRefPtr<Context> mContext;
+    ScopedRefPtr<VulkanBuffer> mBuffer;
+    uint8_t* mMappedData;
+    vk::DeviceSize mFrameCapacity;
+    vk::DeviceSize mAlignment;
+    vk::DeviceSize mFrameBegin;
+    vk::DeviceSize mFrameHead;
+};
+
+}  // namespace VKRT
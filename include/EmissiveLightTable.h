@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Material;
+class Object;
+class VulkanBuffer;
+
+// World space copy of every emissive triangle in the scene plus an alias table over them, so
+// shaders can pick a triangle proportionally to area x emitted power in constant time
+class EmissiveLightTable : public RefCountPtr {
+public:
+    struct Header {
+        uint32_t triangleCount;
+        float totalPower;
+        uint32_t padding[2];
+    };
+
+    struct EmissiveTriangle {
+        glm::vec3 v0;
+        float selectionProbability;
+        glm::vec3 v1;
+        float aliasProbability;
+        glm::vec3 v2;
+        uint32_t alias;
+        glm::vec3 emission;
+        float area;
+    };
+
+    EmissiveLightTable(ScopedRefPtr<Context> context);
+
+    // Rebuilds the table when the geometry moved or an emissive material changed. A rebuild
+    // always goes to a new buffer, frames in flight keep reading the one they bound
+    void Update(const std::vector<ScopedRefPtr<Object>>& objects, bool geometryChanged);
+
+    ScopedRefPtr<VulkanBuffer> GetLightsBuffer() const { return mLightsBuffer; }
+    uint32_t GetTriangleCount() const { return mTriangleCount; }
+
+    ~EmissiveLightTable();
+
+private:
+    ScopedRefPtr<Context> mContext;
+    ScopedRefPtr<VulkanBuffer> mLightsBuffer;
+    uint32_t mTriangleCount;
+
+    // Material versions seen by the last rebuild, in instance order
+    std::vector<const Material*> mMaterials;
+    std::vector<uint32_t> mMaterialVersions;
+};
+
+}  // namespace VKRT
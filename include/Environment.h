@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class ComputePipeline;
+class Context;
+class Texture;
+class VulkanBuffer;
+
+// Radiance arriving from infinitely far away, the miss shader returns it for every ray that
+// escapes the scene. Either the procedural sky or an equirectangular HDR map, maps carry an alias
+// table over their texels so the raygen shader can sample bright regions like the sun directly.
+// The procedural sky is baked into a small octahedral texture by a compute pass, only when the sun
+// moves
+class Environment : public RefCountPtr {
+public:
+    enum class Type : uint32_t { ProceduralSky = 0, Map = 1 };
+
+    // Matches EnvironmentHeader in the shaders
+    struct Header {
+        Type type;
+        uint32_t width;
+        uint32_t height;
+        float intensity;
+        glm::vec3 directionToSun;
+        float padding;
+    };
+
+    // Matches EnvironmentTexel in the shaders, rows go from straight up to straight down.
+    // selectionProbability is proportional to luminance x solid angle
+    struct Texel {
+        glm::vec3 radiance;
+        float selectionProbability;
+        float aliasProbability;
+        uint32_t alias;
+        uint32_t padding[2];
+    };
+
+    // Procedural sky
+    Environment(ScopedRefPtr<Context> context);
+
+    // Equirectangular HDR map, returns nullptr when the file can't be read
+    static Environment* Load(ScopedRefPtr<Context> context, const std::string& path);
+
+    void SetIntensity(float intensity) {
+        mIntensity = intensity;
+        ++mVersion;
+    }
+    float GetIntensity() const { return mIntensity; }
+    // Only the procedural sky has a sun to move
+    void SetDirectionToSun(const glm::vec3& directionToSun) {
+        mDirectionToSun = glm::normalize(directionToSun);
+        ++mVersion;
+    }
+    const glm::vec3& GetDirectionToSun() const { return mDirectionToSun; }
+    Type GetType() const { return mType; }
+
+    // Re-uploads when a setter ran since the last call. It always goes to a new buffer, frames in
+    // flight keep reading the one they bound. A sun change records a sky bake into commandBuffer,
+    // ordered against the ray tracing reads of this and earlier frames
+    void Update(vk::CommandBuffer& commandBuffer);
+
+    // Header followed by the map texels, if any
+    ScopedRefPtr<VulkanBuffer> GetBuffer() const { return mBuffer; }
+    // Baked procedural sky in the general layout, a 1x1 placeholder for maps
+    ScopedRefPtr<Texture> GetSkyTexture() const { return mSkyTexture; }
+    const vk::Sampler& GetSkySampler() const { return mSkySampler; }
+
+    ~Environment();
+
+private:
+    Environment(
+        ScopedRefPtr<Context> context,
+        uint32_t width,
+        uint32_t height,
+        std::vector<Texel>&& texels);
+
+    void CreateSkyTexture(uint32_t size);
+    void CreateSkyBakePipeline();
+    void BakeSky(vk::CommandBuffer& commandBuffer);
+
+    ScopedRefPtr<Context> mContext;
+    Type mType;
+    uint32_t mWidth, mHeight;
+    std::vector<Texel> mTexels;
+    float mIntensity;
+    glm::vec3 mDirectionToSun;
+
+    uint32_t mVersion;
+    uint32_t mUploadedVersion;
+    ScopedRefPtr<VulkanBuffer> mBuffer;
+
+    ScopedRefPtr<Texture> mSkyTexture;
+    vk::Sampler mSkySampler;
+    ScopedRefPtr<ComputePipeline> mSkyBakePipeline;
+    vk::DescriptorSet mSkyBakeSet;
+    bool mSkyBaked;
+    glm::vec3 mBakedDirectionToSun;
+
+    struct SkyBakeConstants {
+        glm::vec3 directionToSun;
+        float texelAngle;
+    };
+
+    // Octahedral texels are close to equal area, at this size the sun disk spans about eight
+    static constexpr uint32_t SkySize = 512;
+};
+
+}  // namespace VKRT
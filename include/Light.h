@@ -10,21 +10,31 @@ class Light : public RefCountPtr {
 public:
     Light();
 
-    void SetIntensity(float intensity) { mIntensity = intensity; }
+    void SetIntensity(float intensity) {
+        mIntensity = intensity;
+        ++mVersion;
+    }
     const float& GetIntensity() const { return mIntensity; }
 
+    // Bumped by every setter, lets the scene re-upload the light buffer only when needed
+    uint32_t GetVersion() const { return mVersion; }
+
     enum class Type : uint32_t { Directional = 0, Point = 1 };
 
+    // Matches the Light struct in the shaders
     struct Proxy {
         Type type;
         glm::vec3 directionOrPosition;
         float intensity;
     };
 
-    virtual Proxy GetProxy() = 0;
+    virtual Proxy GetProxy() const = 0;
 
     virtual ~Light();
 
+protected:
+    uint32_t mVersion;
+
 private:
     float mIntensity;
 };
@@ -33,10 +43,13 @@ class DirectionalLight : public Light {
 public:
     DirectionalLight();
 
-    void SetDirection(const glm::vec3& direction) { mDirection = direction; }
+    void SetDirection(const glm::vec3& direction) {
+        mDirection = direction;
+        ++mVersion;
+    }
     const glm::vec3& GetDirection() const { return mDirection; }
 
-    Proxy GetProxy() override;
+    Proxy GetProxy() const override;
 
     ~DirectionalLight();
 
@@ -48,10 +61,13 @@ class PointLight : public Light {
 public:
     PointLight();
 
-    void SetPosition(const glm::vec3& position) { mPosition = position; }
+    void SetPosition(const glm::vec3& position) {
+        mPosition = position;
+        ++mVersion;
+    }
     const glm::vec3& GetPosition() const { return mPosition; }
 
-    Proxy GetProxy() override;
+    Proxy GetProxy() const override;
 
     ~PointLight();
 
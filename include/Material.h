@@ -37,12 +37,41 @@ public:
     const ScopedRefPtr<Texture> GetAlbedoTexture() const { return mAlbedoTexture; }
     const ScopedRefPtr<Texture> GetRoughnessTexture() const { return mRoughnessTexture; }
 
-    void SetAlbedo(const glm::vec3& albedo) { mAlbedo = albedo; }
-    void SetEmissive(const glm::vec3& emissive) { mEmissive = emissive; }
-    void SetRoughness(float roughness) { mRoughness = roughness; }
-    void SetMetallic(float metallic) { mMetallic = metallic; }
-    void SetTransmission(float transmission) { mTransmission = transmission; }
-    void SetIndexOfRefraction(float indexOfRefraction) { mIndexOfRefraction = indexOfRefraction; }
+    // Bumped by every setter, lets the scene re-upload only the materials that changed
+    uint32_t GetVersion() const { return mVersion; }
+
+    void SetAlbedo(const glm::vec3& albedo) {
+        mAlbedo = albedo;
+        ++mVersion;
+    }
+    void SetEmissive(const glm::vec3& emissive) {
+        mEmissive = emissive;
+        ++mVersion;
+    }
+    void SetRoughness(float roughness) {
+        mRoughness = roughness;
+        ++mVersion;
+    }
+    void SetMetallic(float metallic) {
+        mMetallic = metallic;
+        ++mVersion;
+    }
+    void SetTransmission(float transmission) {
+        mTransmission = transmission;
+        ++mVersion;
+    }
+    void SetIndexOfRefraction(float indexOfRefraction) {
+        mIndexOfRefraction = indexOfRefraction;
+        ++mVersion;
+    }
+    void SetAlbedoTexture(ScopedRefPtr<Texture> albedoTexture) {
+        mAlbedoTexture = albedoTexture;
+        ++mVersion;
+    }
+    void SetRoughnessTexture(ScopedRefPtr<Texture> roughnessTexture) {
+        mRoughnessTexture = roughnessTexture;
+        ++mVersion;
+    }
 
     ~Material();
 
@@ -56,5 +85,7 @@ private:
 
     ScopedRefPtr<Texture> mAlbedoTexture;
     ScopedRefPtr<Texture> mRoughnessTexture;
+
+    uint32_t mVersion;
 };
 }  // namespace VKRT
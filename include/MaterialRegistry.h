@@ -0,0 +1,78 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BindlessTextureTable.h"
+#include "Material.h"
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Texture;
+class VulkanBuffer;
+
+// Persistent GPU copy of every mesh's material plus the bindless texture table they index into.
+// Slots are appended as meshes are registered and only the ones whose Material version moved are
+// re-uploaded. Textures hold a table slot for as long as some material references them
+class MaterialRegistry : public RefCountPtr {
+public:
+    struct MaterialProxy {
+        glm::vec3 albedo;
+        glm::vec3 emissive;
+        float roughness;
+        float metallic;
+        float transmission;
+        float indexOfRefraction;
+        int32_t albedoTextureIndex;
+        int32_t roughnessTextureIndex;
+    };
+
+    // The fallback texture always takes table slot 0
+    MaterialRegistry(ScopedRefPtr<Context> context, ScopedRefPtr<Texture> fallbackTexture);
+
+    // One slot per mesh, in the same order as the mesh descriptions
+    uint32_t Register(ScopedRefPtr<Material> material);
+
+    // Records the uploads for every changed slot, has to run before any shader reads the buffer
+    void Update(vk::CommandBuffer& commandBuffer);
+
+    ScopedRefPtr<VulkanBuffer> GetMaterialsBuffer() const { return mMaterialsBuffer; }
+    ScopedRefPtr<BindlessTextureTable> GetTextureTable() const { return mTextureTable; }
+
+    ~MaterialRegistry();
+
+private:
+    struct Slot {
+        ScopedRefPtr<Material> material;
+        uint32_t version;
+        // The textures the uploaded proxy points at
+        ScopedRefPtr<Texture> albedoTexture;
+        ScopedRefPtr<Texture> roughnessTexture;
+    };
+
+    int32_t AcquireTexture(const ScopedRefPtr<Texture>& texture);
+    void ReleaseTexture(const ScopedRefPtr<Texture>& texture);
+    void RefreshSlot(uint32_t slotIndex);
+
+    struct TextureEntry {
+        uint32_t tableSlot;
+        uint32_t useCount;
+    };
+
+    ScopedRefPtr<Context> mContext;
+    std::vector<Slot> mSlots;
+    std::vector<MaterialProxy> mProxies;
+    ScopedRefPtr<BindlessTextureTable> mTextureTable;
+    std::unordered_map<const Texture*, TextureEntry> mTextureEntries;
+
+    ScopedRefPtr<VulkanBuffer> mMaterialsBuffer;
+    // Slots past this one are not in the GPU buffer yet
+    uint32_t mUploadedSlotCount;
+};
+
+}  // namespace VKRT
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+struct MemoryBlock;
+
+// Buffers and optimally tiled images never share a block, so no two neighbouring suballocations
+// can fall on the same bufferImageGranularity page
+enum class MemoryResourceKind : uint32_t { Linear = 0, Optimal = 1 };
+
+struct MemoryAllocation {
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    uint8_t* mappedData = nullptr;
+    MemoryBlock* block = nullptr;
+};
+
+struct MemoryBlock {
+    vk::DeviceMemory memory;
+    vk::DeviceSize size;
+    uint8_t* mappedData;
+    uint32_t memoryTypeIndex;
+    MemoryResourceKind kind;
+    bool dedicated;
+    vk::DeviceSize allocatedSize;
+    // Free ranges keyed by offset, adjacent ranges are always merged
+    std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+};
+
+class MemoryAllocator {
+public:
+    MemoryAllocator(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice);
+
+    struct Request {
+        vk::MemoryRequirements requirements;
+        uint32_t memoryTypeIndex;
+        MemoryResourceKind kind;
+        bool dedicated;
+        vk::MemoryAllocateFlags allocateFlags;
+        vk::Buffer dedicatedBuffer;
+        vk::Image dedicatedImage;
+    };
+    MemoryAllocation Allocate(const Request& request);
+    void Free(const MemoryAllocation& allocation);
+
+    ~MemoryAllocator();
+
+private:
+    MemoryBlock* CreateBlock(
+        uint32_t memoryTypeIndex,
+        MemoryResourceKind kind,
+        vk::DeviceSize size,
+        bool dedicated,
+        const vk::MemoryAllocateFlags& allocateFlags,
+        const void* allocateInfoNext);
+    void DestroyBlock(MemoryBlock* block);
+    bool TryAllocateFromBlock(
+        MemoryBlock* block,
+        const vk::MemoryRequirements& requirements,
+        MemoryAllocation& allocation);
+
+    vk::DeviceSize GetPreferredBlockSize(uint32_t memoryTypeIndex) const;
+
+    vk::Device mLogicalDevice;
+    vk::PhysicalDeviceMemoryProperties mMemoryProperties;
+    std::vector<std::unique_ptr<MemoryBlock>> mBlocks;
+
+    static constexpr vk::DeviceSize DefaultBlockSize = 64ull * 1024ull * 1024ull;
+};
+
+}  // namespace VKRT
@@ -17,11 +17,17 @@ public:
         glm::vec3 normal;
         glm::vec2 texCoord;
     };
+
+    // LowMemory always compacts, the other policies only when compaction is requested
+    enum class BuildPolicy { FastTrace, FastBuild, LowMemory };
+
     Mesh(
         ScopedRefPtr<Context> context,
         const std::vector<Vertex>& vertices,
         const std::vector<glm::uvec3>& indices,
-        ScopedRefPtr<Material> material);
+        ScopedRefPtr<Material> material,
+        BuildPolicy buildPolicy = BuildPolicy::FastTrace,
+        bool compactBLAS = false);
 
     struct Description {
         vk::DeviceAddress vertexBufferAddress;
@@ -29,10 +35,28 @@ public:
     };
     Description GetDescription() const;
 
+    struct BuildInput {
+        vk::AccelerationStructureGeometryKHR geometry;
+        vk::AccelerationStructureBuildRangeInfoKHR range;
+        vk::BuildAccelerationStructureFlagsKHR flags;
+        vk::DeviceSize scratchSize;
+        bool compact;
+    };
+    const BuildInput& GetBuildInput() const { return mBuildInput; }
+
+    void SetCompactedBLAS(
+        vk::AccelerationStructureKHR compactedBLAS,
+        ScopedRefPtr<VulkanBuffer> compactedBLASBuffer);
+
+    const vk::AccelerationStructureKHR& GetBLAS() const { return mBLAS; }
     vk::DeviceAddress GetBLASAddress() const { return mBLASAddress; }
     const ScopedRefPtr<Material> GetMaterial() const { return mMaterial; }
     ScopedRefPtr<Material> GetMaterial() { return mMaterial; }
 
+    // Object space geometry kept on the CPU, emissive meshes are turned into light triangles
+    const std::vector<glm::vec3>& GetPositions() const { return mPositions; }
+    const std::vector<glm::uvec3>& GetIndices() const { return mIndices; }
+
     ~Mesh();
 
 private:
@@ -45,8 +69,12 @@ private:
     ScopedRefPtr<VulkanBuffer> mBLASBuffer;
     vk::AccelerationStructureKHR mBLAS;
     vk::DeviceAddress mBLASAddress;
+    BuildInput mBuildInput;
 
     ScopedRefPtr<Material> mMaterial;
+
+    std::vector<glm::vec3> mPositions;
+    std::vector<glm::uvec3> mIndices;
 };
 
 }  // namespace VKRT
\ No newline at end of file
@@ -13,7 +13,11 @@ namespace VKRT {
 
 class Model : public RefCountPtr {
 public:
-    static Model* Load(ScopedRefPtr<Context>, const std::string& path);
+    static Model* Load(
+        ScopedRefPtr<Context>,
+        const std::string& path,
+        Mesh::BuildPolicy buildPolicy = Mesh::BuildPolicy::FastTrace,
+        bool compactBLAS = false);
 
     Model(ScopedRefPtr<Context>, const std::vector<ScopedRefPtr<Mesh>>& meshes);
 
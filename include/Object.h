@@ -21,6 +21,9 @@ public:
     void Scale(const glm::vec3& delta);
     void SetScale(const glm::vec3& scale);
 
+    bool IsTransformDirty() const { return mTransformDirty; }
+    void ClearTransformDirty() { mTransformDirty = false; }
+
     ~Object();
 
 private:
@@ -31,6 +34,7 @@ private:
     glm::vec3 mEulerRotation;
     glm::vec3 mScale;
     glm::vec3 mPosition;
+    bool mTransformDirty;
 };
 
 }  // namespace VKRT
\ No newline at end of file
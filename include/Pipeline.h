@@ -14,7 +14,8 @@ namespace VKRT {
 
 class Context;
 
-enum class RayTracingStage { Generate = 0, Hit, Miss };
+// Miss stages are laid out in this order in the miss table, so ShadowMiss is miss index 1
+enum class RayTracingStage { Generate = 0, Hit, Miss, ShadowMiss };
 
 class Pipeline : public RefCountPtr {
 public:
@@ -27,12 +28,16 @@ public:
     Pipeline(
         ScopedRefPtr<Context> context,
         const std::vector<Descriptor>& descriptors,
-        const std::unordered_map<RayTracingStage, Resource::Id>& shaderResourcesMap);
+        const std::unordered_map<RayTracingStage, Resource::Id>& shaderResourcesMap,
+        const std::vector<vk::DescriptorSetLayout>& additionalSetLayouts = {});
 
     const std::vector<vk::DescriptorPoolSize>& GetDescriptorSizes() const;
+    // Set 0, additional set layouts follow it in the order they were given
     const vk::DescriptorSetLayout& GetDescriptorLayout() const { return mDescriptorLayout; }
     const vk::PipelineLayout& GetPipelineLayout() const { return mLayout; }
     const vk::Pipeline& GetPipelineHandle() const { return mPipeline; }
+    // Has to be set with setRayTracingPipelineStackSizeKHR after every bind
+    uint32_t GetStackSize() const { return mStackSize; }
 
     struct RayTracingTablesRef {
         vk::StridedDeviceAddressRegionKHR rayGen, rayHit, rayMiss, callable;
@@ -49,6 +54,7 @@ private:
     std::vector<vk::DescriptorPoolSize> mDescriptorSizes;
     vk::PipelineLayout mLayout;
     vk::Pipeline mPipeline;
+    uint32_t mStackSize;
     std::unordered_map<RayTracingStage, vk::ShaderModule> mShaders;
 
     size_t mHandleSize, mHandleSizeAligned;
@@ -56,5 +62,7 @@ private:
     ScopedRefPtr<VulkanBuffer> mRayHitTable;
     ScopedRefPtr<VulkanBuffer> mRayMissTable;
     RayTracingTablesRef mTableRef;
+
+    static constexpr uint32_t MaxRayRecursionDepth = 1;
 };
 }  // namespace VKRT
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <random>
+
 #include "glm/glm.hpp"
 
+#include "ComputePipeline.h"
 #include "Context.h"
 #include "RefCountPtr.h"
 #include "Texture.h"
@@ -9,34 +12,82 @@
 
 namespace VKRT {
 
+// Dynamic diffuse global illumination volume (Majercik et al. 2019). A regular grid of probes, each
+// storing octahedral irradiance and visibility (mean and mean squared distance to the nearest
+// surface). Every realtime frame a ray pass traces RaysPerProbe rays from each probe, then Update
+// blends them into both atlases with hysteresis
 class ProbeGrid : public RefCountPtr {
 public:
+    static constexpr uint32_t RaysPerProbe = 128;
+    // Octahedral tiles including their one texel border, the border duplicates the opposite edge
+    // so bilinear fetches never bleed into a neighbor probe
+    static constexpr uint32_t IrradianceResolution = 8;
+    static constexpr uint32_t VisibilityResolution = 16;
+
     ProbeGrid(ScopedRefPtr<Context> context);
 
+    // Matches ProbeGridData in the shaders, origin is the position of the first probe
     struct UniformData {
         glm::vec3 origin;
-        glm::vec3 size;
+        float normalBias;
+        glm::vec3 spacing;
+        float maxDistance;
         glm::uvec3 dimensions;
-        uint32_t resolution;
+        uint32_t raysPerProbe;
     };
 
-    const ScopedRefPtr<Texture>& GetTexture() { return mProbesTexture; }
+    // Probes are spread evenly over the box, including its corners
+    void SetVolume(const glm::vec3& center, const glm::vec3& size);
+
+    // Atlases in the general layout, probe (x, y, z) owns tile (x + z * dimensions.x, y)
+    const ScopedRefPtr<Texture>& GetIrradianceTexture() { return mIrradianceTexture; }
+    const ScopedRefPtr<Texture>& GetVisibilityTexture() { return mVisibilityTexture; }
+    // Written by the probe ray pass, one row per probe holding radiance and hit distance
+    const ScopedRefPtr<Texture>& GetRayTexture() { return mRayTexture; }
+    const vk::Sampler& GetSampler() const { return mSampler; }
     const ScopedRefPtr<VulkanBuffer>& GetDescriptionBuffer() { return mProbeGridBuffer; }
 
-    glm::uvec3 GetDispatchDimensions();
+    uint32_t GetProbeCount() const { return mDimensions.x * mDimensions.y * mDimensions.z; }
 
-    void UpdateData();
+    // Picks a new random rotation for this frame's probe rays, so successive frames cover the
+    // sphere between the fixed spherical Fibonacci directions
+    void BeginFrame();
+    const glm::mat4& GetRayRotation() const { return mRayRotation; }
+
+    // Blends this frame's rays into the atlases, expects the probe ray pass writes to be visible
+    // to compute reads. The atlases are left ready for ray tracing reads
+    void Update(vk::CommandBuffer& commandBuffer);
 
     virtual ~ProbeGrid();
 
 private:
+    void UpdateData();
+
+    struct UpdateConstants {
+        glm::mat4 rayRotation;
+        uint32_t updateVisibility;
+        float hysteresis;
+    };
+
     ScopedRefPtr<Context> mContext;
-    ScopedRefPtr<Texture> mProbesTexture;
+    ScopedRefPtr<Texture> mIrradianceTexture;
+    ScopedRefPtr<Texture> mVisibilityTexture;
+    ScopedRefPtr<Texture> mRayTexture;
     ScopedRefPtr<VulkanBuffer> mProbeGridBuffer;
+    vk::Sampler mSampler;
     glm::vec3 mOrigin;
     glm::vec3 mSize;
     glm::uvec3 mDimensions;
-    uint32_t mResolution;
+
+    ScopedRefPtr<ComputePipeline> mUpdatePipeline;
+    vk::DescriptorSet mUpdateSet;
+    glm::mat4 mRayRotation;
+    std::mt19937 mGenerator;
+    uint32_t mUpdateCount;
+
+    // Fraction of the previous value kept by every update, high values are stable but slow to
+    // react to lighting changes
+    static constexpr float Hysteresis = 0.97f;
 };
 
-}  // namespace VKRT
\ No newline at end of file
+}  // namespace VKRT
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ComputePipeline.h"
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class VulkanBuffer;
+
+// World space radiance cache for realtime mode, a GPU hash grid after SHaRC and Gautron's spatial
+// hashing (2020). Cells are keyed on quantized position and dominant normal axis, and grow with
+// distance to the camera. Paths add the radiance they gathered past each of their hits to the
+// hit's cell and stop at their third hit when its cell already holds enough samples. Resolve
+// folds every frame's additions into the cached value and evicts cells no path has touched lately
+class RadianceCache : public RefCountPtr {
+public:
+    // Mirror RadianceCacheCapacity and RadianceCacheResolveWidth in definitions.glsl
+    static constexpr uint32_t Capacity = 1 << 19;
+    static constexpr uint32_t ResolveWidth = 1024;
+
+    // Matches RadianceCacheEntry in the shaders. Paths add fixed point radiance to the accumulated
+    // fields with atomics, only Resolve touches the rest
+    struct Entry {
+        uint32_t checksum;
+        uint32_t age;
+        uint32_t sampleCount;
+        uint32_t accumulatedCount;
+        uint32_t accumulatedRed;
+        uint32_t accumulatedGreen;
+        uint32_t accumulatedBlue;
+        uint32_t padding;
+        float radiance[3];
+        float padding2;
+    };
+
+    RadianceCache(ScopedRefPtr<Context> context);
+
+    ScopedRefPtr<VulkanBuffer> GetBuffer() const { return mBuffer; }
+
+    // Expects the raygen writes of this frame to be visible to compute reads. The cache is left
+    // ready for the next frame's ray tracing reads and atomics
+    void Resolve(vk::CommandBuffer& commandBuffer);
+
+    ~RadianceCache();
+
+private:
+    ScopedRefPtr<Context> mContext;
+    ScopedRefPtr<VulkanBuffer> mBuffer;
+    ScopedRefPtr<ComputePipeline> mResolvePipeline;
+    vk::DescriptorSet mResolveSet;
+};
+
+}  // namespace VKRT
@@ -1,40 +1,165 @@
 #pragma once
 
 #include "Camera.h"
+#include "ComputePipeline.h"
 #include "Context.h"
+#include "Denoiser.h"
+#include "DynamicBufferRing.h"
 #include "Pipeline.h"
 #include "ProbeGrid.h"
+#include "RadianceCache.h"
 #include "RefCountPtr.h"
+#include "SamplerTables.h"
 #include "Scene.h"
 
 namespace VKRT {
 class Renderer : public RefCountPtr, public InputEventListener {
 public:
-    Renderer(ScopedRefPtr<Context> context, ScopedRefPtr<Scene> scene);
+    // Where the raygen shader draws its random numbers from. Final renders always use Sobol
+    enum class SamplerMode { Sobol, BlueNoise };
+
+    Renderer(
+        ScopedRefPtr<Context> context,
+        ScopedRefPtr<Scene> scene,
+        uint32_t framesInFlight = DefaultFramesInFlight);
 
     void Render(Camera* camera);
 
+    // Longest path the raygen shader follows in each mode, picked up by the next frame. Russian
+    // roulette ends most paths well before this, it only bounds the worst case
+    void SetMaxBounces(uint32_t maxBounces) { mMaxBounces = maxBounces; }
+    void SetFinalRenderMaxBounces(uint32_t maxBounces) { mFinalRenderMaxBounces = maxBounces; }
+    // Final renders stop sampling a pixel once the standard error of its mean luminance drops
+    // below this fraction of the mean. Zero always traces the full sample budget
+    void SetFinalRenderErrorThreshold(float errorThreshold) {
+        mFinalRenderErrorThreshold = errorThreshold;
+    }
+    // Blue noise converges slower than Sobol but spreads its error as high frequency noise, which
+    // looks better while the camera moves and few samples have accumulated
+    void SetRealtimeSamplerMode(SamplerMode samplerMode) { mRealtimeSamplerMode = samplerMode; }
+    // Filters the realtime image before display, final renders are always shown as accumulated
+    void SetDenoiserEnabled(bool enabled) { mDenoiserEnabled = enabled; }
+    // Realtime paths stop at their second hit and read diffuse light from the probe grid, which
+    // traces its own rays every frame. Final renders always trace full paths
+    void SetProbesEnabled(bool enabled) { mProbesEnabled = enabled; }
+    const ScopedRefPtr<ProbeGrid>& GetProbeGrid() { return mProbeGrid; }
+    // Realtime paths write what they gather into a world space cache and stop at their third hit
+    // when it already knows the radiance there. Unlike the probes it needs no bounded volume
+    void SetRadianceCacheEnabled(bool enabled) { mRadianceCacheEnabled = enabled; }
+    // Realtime primary hits take their emitter light from ReSTIR reservoirs, resampled from many
+    // candidates and reused across frames and neighboring pixels
+    void SetReSTIREnabled(bool enabled) { mReSTIREnabled = enabled; }
+
     ~Renderer();
 
 private:
-    void CreateStorageImage();
+    // Everything the CPU writes while recording a frame, recycled once the slot's fence signals
+    struct FrameResources {
+        vk::CommandBuffer commandBuffer;
+        vk::Fence fence;
+        vk::Semaphore imageAcquiredSemaphore;
+        vk::Semaphore renderFinishedSemaphore;
+        ScopedRefPtr<VulkanBuffer> sceneBuffer;
+        ScopedRefPtr<VulkanBuffer> materialsBuffer;
+        ScopedRefPtr<VulkanBuffer> emissiveTrianglesBuffer;
+        ScopedRefPtr<VulkanBuffer> lightsBuffer;
+        ScopedRefPtr<VulkanBuffer> environmentBuffer;
+        // Keeps the sky texture and sampler alive if the scene switches environments
+        ScopedRefPtr<Environment> environment;
+        ScopedRefPtr<VulkanBuffer> instanceBuffer;
+        vk::DescriptorSet descriptorSet;
+        vk::DescriptorSet displayDescriptorSet;
+        // What the set currently points at, bindings are only rewritten when these change
+        uint32_t boundTLASVersion = 0;
+        uint32_t boundSceneVersion = 0;
+        vk::Buffer boundMaterialsBuffer;
+        vk::Buffer boundEmissiveTrianglesBuffer;
+        vk::Buffer boundLightsBuffer;
+        vk::Buffer boundEnvironmentBuffer;
+        vk::ImageView boundSkyImage;
+        vk::ImageView boundOutputImage;
+        vk::ImageView boundDisplayInput;
+        // Out of range until the history bindings are first written
+        uint32_t boundHistoryIndex = Denoiser::HistoryCount;
+    };
+
+    void CreateFrameResources(uint32_t framesInFlight);
+    void CreateAccumulationImages();
     void CreateUniformBuffer();
     void CreateMaterialUniforms();
-    void CreateDescriptors(const Scene::SceneMaterials& materialInfo);
-    void UpdateDescriptors(const Scene::SceneMaterials& materialInfo);
+    void CreateDescriptors();
+    void UpdateDescriptors(FrameResources& frame);
+    bool IsDenoising() const {
+        return mDenoiserEnabled && mCurrentMode == Renderer::Mode::Realtime;
+    }
+    bool IsTracingProbes() const {
+        return mProbesEnabled && mCurrentMode == Renderer::Mode::Realtime;
+    }
+    bool IsUsingRadianceCache() const {
+        return mRadianceCacheEnabled && mCurrentMode == Renderer::Mode::Realtime;
+    }
+    bool IsResampling() const {
+        return mReSTIREnabled && mCurrentMode == Renderer::Mode::Realtime;
+    }
+    void CreateReSTIRResources();
+    // Binds a pipeline that shares the main pass layout and traces width x height rays
+    void TraceRays(
+        vk::CommandBuffer& commandBuffer,
+        Pipeline* pipeline,
+        const std::vector<vk::DescriptorSet>& descriptorSets,
+        uint32_t cameraOffset,
+        uint32_t width,
+        uint32_t height);
     struct CameraProperties {
         glm::mat4 viewInverse;
         glm::mat4 projInverse;
+        // Last frame's camera, the raygen shader reprojects history through them
+        glm::mat4 previousViewInverse;
+        glm::mat4 previousViewProjection;
+        // Rotation applied to this frame's probe rays, the probe update pass uses the same one
+        glm::mat4 probeRayRotation;
         uint32_t framesSinceMoved;
-        uint32_t randomSeed;
+        uint32_t frameIndex;
+        uint32_t samplerMode;
         uint32_t currentMode;
         uint32_t currentTile;
         uint32_t tileSize;
         uint32_t tileCount;
+        uint32_t maxBounces;
+        float errorThreshold;
+        // Realtime paths end at their second hit and read the probe grid instead
+        uint32_t probesEnabled;
+        uint32_t radianceCacheEnabled;
+        uint32_t restirEnabled;
     };
 
-    void UpdateCameraUniforms(Camera* camera);
-    void UpdateMaterialUniforms(const Scene::SceneMaterials& materialInfo);
+    // Match ReSTIRSurface and ReSTIRReservoir in the shaders
+    struct ReSTIRSurface {
+        glm::vec3 position;
+        float hitDistance;
+        glm::vec3 normal;
+        float roughness;
+        glm::vec3 albedo;
+        float metallic;
+        glm::vec3 toView;
+        float padding;
+    };
+    struct ReSTIRReservoir {
+        glm::vec3 lightPosition;
+        float weightSum;
+        glm::vec3 lightNormal;
+        float sampleCount;
+        glm::vec3 emission;
+        float contributionWeight;
+    };
+    // Mirrors ReSTIRSpatialConstants in restirSpatial.comp
+    struct ReSTIRSpatialConstants {
+        glm::uvec2 imageSize;
+        uint32_t frameIndex;
+    };
+
+    // Returns the dynamic offset of the camera constants in the uniform ring
+    uint32_t UpdateCameraUniforms(Camera* camera);
 
     void OnKeyPressed(int key) override;
     void OnKeyReleased(int key) override;
@@ -47,23 +172,68 @@ private:
     ScopedRefPtr<Context> mContext;
     ScopedRefPtr<Scene> mScene;
 
-    ScopedRefPtr<Texture> mStorageTexture;
+    // Linear radiance in full float precision, 8 bit history stalls the running average. Realtime
+    // frames alternate between the two, the one at mHistoryIndex is the current frame's
+    std::array<ScopedRefPtr<Texture>, Denoiser::HistoryCount> mAccumulationTextures;
+    uint32_t mHistoryIndex;
+    ScopedRefPtr<SamplerTables> mSamplerTables;
+    ScopedRefPtr<Denoiser> mDenoiser;
+    ScopedRefPtr<ProbeGrid> mProbeGrid;
+    ScopedRefPtr<RadianceCache> mRadianceCache;
+    // Per pixel primary hits and reservoirs of the resampling passes. The final reservoirs
+    // alternate with the history so the first pass can reproject last frame's
+    ScopedRefPtr<VulkanBuffer> mReSTIRSurfaceBuffer;
+    ScopedRefPtr<VulkanBuffer> mTemporalReservoirBuffer;
+    std::array<ScopedRefPtr<VulkanBuffer>, Denoiser::HistoryCount> mReservoirBuffers;
+    // Spatial resampling only reads buffers, it runs as a compute pass with one set per history
+    // index that writes that index's final reservoirs
+    ScopedRefPtr<ComputePipeline> mReSTIRSpatialPipeline;
+    std::array<vk::DescriptorSet, Denoiser::HistoryCount> mReSTIRSpatialSets;
 
-    ScopedRefPtr<VulkanBuffer> mCameraUniformBuffer;
+    // Mesh descriptions indexed by instance custom index, replaced on every topology change.
+    // mSceneBufferVersion counts the replacements, mSceneTopologyVersion is the scene's topology
+    // the current buffer was built for
     ScopedRefPtr<VulkanBuffer> mSceneUniformBuffer;
-    ScopedRefPtr<VulkanBuffer> mMaterialsBuffer;
+    uint32_t mSceneBufferVersion;
+    uint32_t mSceneTopologyVersion;
+    ScopedRefPtr<DynamicBufferRing> mUniformRing;
+
+    std::vector<FrameResources> mFrames;
+    uint32_t mCurrentFrame;
 
     ScopedRefPtr<Pipeline> mMainPassPipeline;
+    // Same layout as the main pass with the probe raygen shader, it binds the same sets
+    ScopedRefPtr<Pipeline> mProbePipeline;
+    // Traces the primary hits and does candidate and temporal resampling, same layout as the main
+    // pass
+    ScopedRefPtr<Pipeline> mReSTIRInitialPipeline;
+    // Tonemaps the accumulation image into the swapchain image
+    ScopedRefPtr<ComputePipeline> mDisplayPipeline;
     vk::DescriptorPool mDescriptorPool;
-    vk::DescriptorSet mDescriptorSet;
 
     vk::Sampler mTextureSampler;
 
     enum class Mode { Realtime, FinalRender };
     Mode mCurrentMode;
     uint32_t mCurrentTile;
+    uint32_t mMaxBounces;
+    uint32_t mFinalRenderMaxBounces;
+    float mFinalRenderErrorThreshold;
+    SamplerMode mRealtimeSamplerMode;
+    bool mDenoiserEnabled;
+    bool mProbesEnabled;
+    bool mRadianceCacheEnabled;
+    bool mReSTIREnabled;
+    uint32_t mFrameIndex;
+    glm::mat4 mPreviousViewInverse;
+    glm::mat4 mPreviousViewProjection;
 
     static constexpr uint32_t TileCount = 1440;
+    static constexpr uint32_t DefaultFramesInFlight = 2;
+    static constexpr uint32_t DefaultMaxBounces = 4;
+    static constexpr uint32_t DefaultFinalRenderMaxBounces = 32;
+    static constexpr float DefaultFinalRenderErrorThreshold = 0.01f;
+    static constexpr vk::DeviceSize UniformRingFrameSize = 64 * 1024;
 };
 
 }  // namespace VKRT
\ No newline at end of file
@@ -15,6 +15,16 @@ struct Resource {
         GenShader,
         HitShader,
         MissShader,
+        ShadowMissShader,
+        DisplayShader,
+        DenoiseVarianceShader,
+        DenoiseAtrousShader,
+        SkyBakeShader,
+        ProbeGenShader,
+        ProbeUpdateShader,
+        RadianceCacheResolveShader,
+        ReSTIRInitialShader,
+        ReSTIRSpatialShader,
     };
 };
 
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class VulkanBuffer;
+
+// Read-only tables behind the shader sampler, generated on the host and uploaded once: Sobol
+// direction numbers for the first four dimensions (scrambled and padded in the shader) followed
+// by a tileable blue noise mask used by the realtime mode
+class SamplerTables : public RefCountPtr {
+public:
+    static constexpr uint32_t SobolDimensions = 4;
+    static constexpr uint32_t SobolBits = 32;
+    static constexpr uint32_t BlueNoiseSize = 64;
+
+    SamplerTables(ScopedRefPtr<Context> context);
+
+    ScopedRefPtr<VulkanBuffer> GetBuffer() const { return mBuffer; }
+
+    ~SamplerTables();
+
+private:
+    static std::vector<uint32_t> GenerateSobolDirections();
+    // Void and cluster (Ulichney 1993) on a torus, returns the normalized rank of every texel
+    static std::vector<float> GenerateBlueNoise();
+
+    ScopedRefPtr<Context> mContext;
+    ScopedRefPtr<VulkanBuffer> mBuffer;
+};
+
+}  // namespace VKRT
@@ -2,6 +2,10 @@
 
 #include <vector>
 
+#include "EmissiveLightTable.h"
+#include "Environment.h"
+#include "Light.h"
+#include "MaterialRegistry.h"
 #include "Object.h"
 #include "RefCountPtr.h"
 #include "VulkanBase.h"
@@ -16,42 +20,67 @@ public:
     Scene(ScopedRefPtr<Context> context);
 
     void AddObject(ScopedRefPtr<Object> object);
+    void AddLight(ScopedRefPtr<Light> light);
+    // Scenes start with the procedural sky
+    void SetEnvironment(ScopedRefPtr<Environment> environment);
 
     const vk::AccelerationStructureKHR& GetTLAS() const { return mTLAS; }
+    // Bumped every time the TLAS is recreated. A new TLAS can reuse the destroyed one's handle
+    // value, so descriptors have to be rewritten on this rather than on the handle. Zero until
+    // the first TLAS exists
+    uint32_t GetTLASVersion() const { return mTLASVersion; }
 
     std::vector<Mesh::Description> GetDescriptions();
+    // Bumped whenever Update rebuilds for a changed set of objects or meshes, the descriptions
+    // and instance custom indices change with it
+    uint32_t GetTopologyVersion() const { return mTopologyVersion; }
 
-    struct MaterialProxy {
-        glm::vec3 albedo;
-        glm::vec3 emissive;
-        float roughness;
-        float metallic;
-        float transmission;
-        float indexOfRefraction;
-        int32_t albedoTextureIndex;
-        int32_t roughnessTextureIndex;
-    };
-    struct SceneMaterials {
-        std::vector<MaterialProxy> materials;
-        std::vector<ScopedRefPtr<Texture>> textures;
-    };
-    SceneMaterials GetMaterialProxies();
+    ScopedRefPtr<MaterialRegistry> GetMaterialRegistry() { return mMaterialRegistry; }
+    ScopedRefPtr<EmissiveLightTable> GetEmissiveLightTable() { return mEmissiveLightTable; }
+    // Header followed by one Light::Proxy per analytic light, replaced whenever a light changes
+    ScopedRefPtr<VulkanBuffer> GetLightsBuffer() const { return mLightsBuffer; }
+    ScopedRefPtr<Environment> GetEnvironment() const { return mEnvironment; }
 
-    void Update(vk::CommandBuffer& commandBuffer);
+    // The instance buffer belongs to the caller's frame slot, it is grown when needed and only
+    // written when the TLAS has to be refit or rebuilt
+    void Update(vk::CommandBuffer& commandBuffer, ScopedRefPtr<VulkanBuffer>& instanceBuffer);
+
+    // Transform-only changes refit the TLAS in place, after this many refits it gets rebuilt to
+    // recover trace performance
+    void SetMaxRefitsBeforeRebuild(uint32_t maxRefits) { mMaxRefitsBeforeRebuild = maxRefits; }
 
     ~Scene();
 
 private:
+    struct LightsHeader {
+        uint32_t lightCount;
+        uint32_t padding[3];
+    };
+    void UpdateLights();
+
     ScopedRefPtr<Context> mContext;
 
     std::vector<ScopedRefPtr<Object>> mObjects;
+    std::vector<ScopedRefPtr<Light>> mLights;
+    std::vector<uint32_t> mLightVersions;
+    ScopedRefPtr<VulkanBuffer> mLightsBuffer;
 
-    ScopedRefPtr<VulkanBuffer> mInstanceBuffer;
     ScopedRefPtr<VulkanBuffer> mTLASBuffer;
     ScopedRefPtr<VulkanBuffer> mScratchBuffer;
     vk::AccelerationStructureKHR mTLAS;
     vk::DeviceAddress mTLASAddress;
+    uint32_t mTLASVersion;
+
+    bool mTopologyDirty;
+    uint32_t mTopologyVersion;
+    uint32_t mInstanceCount;
+    uint32_t mRefitCount;
+    uint32_t mMaxRefitsBeforeRebuild;
+
+    ScopedRefPtr<MaterialRegistry> mMaterialRegistry;
+    ScopedRefPtr<EmissiveLightTable> mEmissiveLightTable;
+    ScopedRefPtr<Environment> mEnvironment;
 
-    ScopedRefPtr<Texture> mDummyTexture;
+    static constexpr uint32_t DefaultMaxRefitsBeforeRebuild = 64;
 };
 }  // namespace VKRT
\ No newline at end of file
@@ -6,3 +6,11 @@
 #define VKRT_RESOURCE_RAYTRACE_PROBE_HIT_SHADER 1006
 #define VKRT_RESOURCE_RAYTRACE_PROBE_MISS_SHADER 1007
 #define VKRT_RESOURCE_RAYTRACE_PROBE_SHADOW_MISS_SHADER 1008
+#define VKRT_RESOURCE_DISPLAY_SHADER 1009
+#define VKRT_RESOURCE_DENOISE_VARIANCE_SHADER 1010
+#define VKRT_RESOURCE_DENOISE_ATROUS_SHADER 1011
+#define VKRT_RESOURCE_SKY_BAKE_SHADER 1012
+#define VKRT_RESOURCE_PROBE_UPDATE_SHADER 1013
+#define VKRT_RESOURCE_RADIANCE_CACHE_RESOLVE_SHADER 1014
+#define VKRT_RESOURCE_RESTIR_INITIAL_SHADER 1015
+#define VKRT_RESOURCE_RESTIR_SPATIAL_SHADER 1016
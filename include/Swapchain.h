@@ -20,11 +20,8 @@ public:
 
     Texture* GetCurrentImage() { return mImages[mCurrentImageIndex]; }
 
-    void AcquireNextImage();
-    void Present();
-
-    vk::Semaphore& GetPresentSemaphore() { return mPresentSemaphore; }
-    vk::Semaphore& GetRenderSemaphore() { return mRenderSemaphore; }
+    void AcquireNextImage(const vk::Semaphore& acquiredSemaphore);
+    void Present(const vk::Semaphore& renderFinishedSemaphore);
 
     ~Swapchain();
 
@@ -34,8 +31,6 @@ private:
     vk::Format mFormat;
     vk::Extent2D mExtent;
     std::vector<ScopedRefPtr<Texture>> mImages;
-    vk::Semaphore mPresentSemaphore;
-    vk::Semaphore mRenderSemaphore;
     uint32_t mCurrentImageIndex;
 };
 }  // namespace VKRT
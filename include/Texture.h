@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Context.h"
+#include "MemoryAllocator.h"
 #include "RefCountPtr.h"
 #include "VulkanBase.h"
 
@@ -34,8 +35,22 @@ public:
         const uint8_t* buffer,
         size_t bufferSize);
 
+    // Storage image in the general layout, cleared to zero so passes never read garbage from it.
+    // The transition and clear are recorded into commandBuffer, callers batch several images into
+    // one submission
+    static ScopedRefPtr<Texture> CreateStorageImage(
+        ScopedRefPtr<Context> context,
+        vk::CommandBuffer& commandBuffer,
+        uint32_t width,
+        uint32_t height,
+        vk::Format format,
+        vk::ImageUsageFlags additionalUsageFlags = {});
+
     const vk::ImageView& GetImageView() const { return mImageView; }
     const vk::Image& GetImage() const { return mImage; }
+    uint32_t GetWidth() const { return mWidth; }
+    uint32_t GetHeight() const { return mHeight; }
+    uint32_t GetLayers() const { return mLayers; }
 
     void SetImageLayout(
         vk::CommandBuffer& commandBuffer,
@@ -50,7 +65,7 @@ private:
     ScopedRefPtr<Context> mContext;
 
     vk::Image mImage;
-    vk::DeviceMemory mMemory;
+    MemoryAllocation mAllocation;
     vk::ImageView mImageView;
     bool ownsImage;
     uint32_t mWidth, mHeight, mLayers;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "RefCountPtr.h"
+#include "VulkanBase.h"
+
+namespace VKRT {
+
+class Context;
+class Texture;
+class VulkanBuffer;
+
+// Packs host to device copies into a persistently mapped staging ring and submits them in
+// batches, on the transfer only queue family when the device exposes one. Every batch signals
+// a value on a timeline semaphore, consumers either wait on it on the GPU or call Wait
+class UploadManager : public RefCountPtr {
+public:
+    using Ticket = uint64_t;
+
+    UploadManager(ScopedRefPtr<Context> context);
+
+    void UploadBuffer(
+        ScopedRefPtr<VulkanBuffer> destination,
+        const void* data,
+        vk::DeviceSize size,
+        vk::DeviceSize destinationOffset = 0);
+    // Leaves the whole texture in eShaderReadOnlyOptimal, owned by the graphics queue family
+    void UploadTexture(ScopedRefPtr<Texture> texture, const void* data, vk::DeviceSize size);
+
+    // Submits everything recorded so far, returns the ticket that signals once it is usable
+    Ticket Flush();
+    bool IsComplete(Ticket ticket);
+    void Wait(Ticket ticket);
+
+    const vk::Semaphore& GetTimelineSemaphore() const { return mTimelineSemaphore; }
+    Ticket GetLastSubmittedTicket() const { return mLastSubmittedTicket; }
+
+    ~UploadManager();
+
+private:
+    struct Batch {
+        vk::CommandBuffer transferCommandBuffer;
+        vk::CommandBuffer acquireCommandBuffer;
+        bool hasStagingData = false;
+        vk::DeviceSize stagingBegin = 0;
+        vk::DeviceSize stagingEnd = 0;
+        Ticket ticket = 0;
+        std::vector<vk::BufferMemoryBarrier> bufferAcquires;
+        std::vector<vk::ImageMemoryBarrier> imageAcquires;
+        // Kept alive until the GPU is done with them
+        std::vector<ScopedRefPtr<VulkanBuffer>> buffers;
+        std::vector<ScopedRefPtr<Texture>> textures;
+    };
+
+    struct StagingRegion {
+        vk::Buffer buffer;
+        vk::DeviceSize offset;
+        uint8_t* data;
+    };
+    StagingRegion AllocateStaging(vk::DeviceSize size);
+    void BeginBatch();
+    void RetireCompletedBatches();
+
+    ScopedRefPtr<Context> mContext;
+    bool mUsesTransferQueue;
+    vk::CommandPool mTransferCommandPool;
+    vk::CommandPool mAcquireCommandPool;
+
+    vk::Semaphore mTimelineSemaphore;
+    uint64_t mTimelineValue;
+    Ticket mLastSubmittedTicket;
+
+    ScopedRefPtr<VulkanBuffer> mStagingRing;
+    vk::DeviceSize mStagingHead;
+    vk::DeviceSize mStagingAlignment;
+
+    Batch mBatch;
+    std::deque<Batch> mInFlightBatches;
+
+    static constexpr vk::DeviceSize StagingRingSize = 64ull * 1024ull * 1024ull;
+};
+
+}  // namespace VKRT
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Context.h"
+#include "MemoryAllocator.h"
 #include "RefCountPtr.h"
 #include "VulkanBase.h"
 
@@ -14,7 +15,8 @@ public:
         const vk::DeviceSize& size,
         const vk::BufferUsageFlags& usageFlags,
         const vk::MemoryPropertyFlags& memoryFlags,
-        const vk::MemoryAllocateFlags& memoryAllocateFlags = {});
+        const vk::MemoryAllocateFlags& memoryAllocateFlags = {},
+        const vk::MemoryPropertyFlags& preferredMemoryFlags = {});
 
     const vk::DeviceSize& GetBufferSize() const { return mSize; }
     const vk::Buffer& GetBufferHandle() const { return mBufferHandle; }
@@ -30,7 +32,7 @@ private:
         ScopedRefPtr<Context> context,
         vk::DeviceSize size,
         vk::Buffer bufferHandle,
-        vk::DeviceMemory memoryHandle,
+        MemoryAllocation allocation,
         vk::DescriptorBufferInfo descriptorInfo);
 
     ~VulkanBuffer() override;
@@ -38,7 +40,7 @@ private:
     ScopedRefPtr<Context> mContext;
     vk::DeviceSize mSize;
     vk::Buffer mBufferHandle;
-    vk::DeviceMemory mMemoryHandle;
+    MemoryAllocation mAllocation;
     vk::DescriptorBufferInfo mDescriptorInfo;
 };
 }  // namespace VKRT
@@ -0,0 +1,21 @@
+// Frame constants shared by the raygen shaders, mirrors Renderer::CameraProperties
+layout(binding = 2, set = 0) uniform CameraProperties {
+    mat4 viewInverse;
+    mat4 projInverse;
+    mat4 previousViewInverse;
+    mat4 previousViewProjection;
+    mat4 probeRayRotation;
+    uint framesSinceMoved;
+    uint frameIndex;
+    uint samplerMode;
+    uint currentMode;
+    uint currentTile;
+    uint tileSize;
+    uint tileCount;
+    uint maxBounces;
+    float errorThreshold;
+    uint probesEnabled;
+    uint radianceCacheEnabled;
+    uint restirEnabled;
+}
+cameraProperties;
@@ -4,6 +4,7 @@ const int ColorPayloadIndex = 0;
 const int ShadowPayloadIndex = 1;
 
 const int ColorMissIndex = 0;
+const int ShadowMissIndex = 1;
 
 const float TMin = 0.01;
 const float TMax = 1000.0;
@@ -17,10 +18,20 @@ const float Bias = 0.01;
 
 const float Pi = 3.14159265359;
 
-const uint MaxRecursionLevel = 4;
+// Paths always survive this many bounces, after that they are terminated by Russian roulette
+const uint RussianRouletteMinBounces = 3;
+const float RussianRouletteMaxSurvival = 0.95;
+
+// Mirrors ComputePipeline::WorkgroupSize
+const uint ComputeWorkgroupSize = 8;
 
 const uint RealtimeRaysPerPixel = 1;
 const uint FinalRenderRaysPerPixel = 15000;
+// Final renders test for convergence every batch once the minimum is reached. Luminance below the
+// floor counts as the floor, so near black pixels don't chase a tiny relative error
+const uint AdaptiveMinSamples = 256;
+const uint AdaptiveBatchSize = 64;
+const float AdaptiveLuminanceFloor = 0.01;
 
 const uint MaxUInt = 0xFFFFFFFF;
 
@@ -31,6 +42,14 @@ const uint AllMask = OpaqueMask | RefractiveMask;
 const uint ModeRealtime = 0;
 const uint ModeFinalRender = 1;
 
+const uint SamplerModeSobol = 0;
+const uint SamplerModeBlueNoise = 1;
+
+// Mirror SamplerTables
+const uint SobolDimensions = 4;
+const uint SobolBits = 32;
+const uint BlueNoiseSize = 64;
+
 struct MeshDescription {
     uint64_t vertexBufferAddress;
     uint64_t indexBufferAddress;
@@ -53,6 +72,133 @@ struct Material {
     int roughnessTextureIndex;
 };
 
+// Mirrors EmissiveLightTable::EmissiveTriangle, selectionProbability is already normalized
+struct EmissiveTriangle {
+    vec3 v0;
+    float selectionProbability;
+    vec3 v1;
+    float aliasProbability;
+    vec3 v2;
+    uint alias;
+    vec3 emission;
+    float area;
+};
+
+const uint LightTypeDirectional = 0;
+const uint LightTypePoint = 1;
+
+// Mirrors Light::Proxy, directional lights store the direction light travels in
+struct Light {
+    uint type;
+    vec3 directionOrPosition;
+    float intensity;
+};
+
+const uint EnvironmentTypeProceduralSky = 0;
+const uint EnvironmentTypeMap = 1;
+
+// Mirrors Environment::Header
+struct EnvironmentHeader {
+    uint type;
+    uint width;
+    uint height;
+    float intensity;
+    vec3 directionToSun;
+    float padding;
+};
+
+// Mirrors Environment::Texel, selectionProbability is already normalized
+struct EnvironmentTexel {
+    vec3 radiance;
+    float selectionProbability;
+    float aliasProbability;
+    uint alias;
+    uvec2 padding;
+};
+
+// Mirror ProbeGrid::IrradianceResolution and ProbeGrid::VisibilityResolution, both include the one
+// texel tile border
+const uint ProbeIrradianceResolution = 8;
+const uint ProbeVisibilityResolution = 16;
+// Realtime paths stop at the second hit and read the probes there, unless the surface is glossy
+// enough that its indirect light is mostly specular
+const float ProbeTerminationRoughness = 0.5;
+
+// Mirrors ProbeGrid::UniformData, origin is the position of the first probe
+struct ProbeGridData {
+    vec3 origin;
+    float normalBias;
+    vec3 spacing;
+    float maxDistance;
+    uvec3 dimensions;
+    uint raysPerProbe;
+};
+
+// Mirror RadianceCache::Capacity and RadianceCache::ResolveWidth
+const uint RadianceCacheCapacity = 1 << 19;
+const uint RadianceCacheResolveWidth = 1024;
+// Slots tried after the hashed one before a cell gives up
+const uint RadianceCacheProbeSteps = 8;
+// Cells are this wide up to RadianceCacheLodDistance from the camera and double in size every
+// time the distance doubles
+const float RadianceCacheCellSize = 0.1;
+const float RadianceCacheLodDistance = 4.0;
+const uint RadianceCacheMaxLevel = 10;
+// Paths read the cache from their third hit on, once a cell has averaged this many samples
+const uint RadianceCacheLookupBounce = 2;
+// Hits per path that write into the cache, the first one isn't cached
+const uint RadianceCacheMaxVertices = 4;
+const uint RadianceCacheMinSamples = 4;
+// Resolved samples are capped so the cache keeps following lighting changes
+const uint RadianceCacheMaxSamples = 256;
+// Cells no path has written for this many frames are evicted
+const uint RadianceCacheMaxAge = 64;
+// Radiance is accumulated with integer atomics in this fixed point scale. Samples are clamped to
+// RadianceCacheMaxRadiance and a cell keeps at most RadianceCacheMaxFrameSamples of them per frame,
+// so its 32 bit sums can't overflow. Coarse cells far from the camera are the ones that hit the cap
+const float RadianceCacheFixedPointScale = 1024.0;
+const float RadianceCacheMaxRadiance = 64.0;
+const uint RadianceCacheMaxFrameSamples =
+    uint(4294967295.0 / (RadianceCacheMaxRadiance * RadianceCacheFixedPointScale)) - 1;
+
+// Mirrors RadianceCache::Entry
+struct RadianceCacheEntry {
+    uint checksum; // Zero when the slot is free
+    uint age;
+    uint sampleCount;
+    uint accumulatedCount;
+    uint accumulatedRed;
+    uint accumulatedGreen;
+    uint accumulatedBlue;
+    uint padding;
+    vec3 radiance;
+    float padding2;
+};
+
+// Mirrors Renderer::ReSTIRSurface, the primary hit the resampling passes found for a pixel.
+// Position is already pushed off the surface along the facing normal
+struct ReSTIRSurface {
+    vec3 position;
+    float hitDistance; // Negative when the camera ray missed
+    vec3 normal;
+    float roughness;
+    vec3 albedo;
+    float metallic;
+    vec3 toView;
+    float padding;
+};
+
+// Mirrors Renderer::ReSTIRReservoir, one chosen point on an emissive triangle with the resampling
+// weight sum, the number of candidates it stands for and its unbiased contribution weight
+struct ReSTIRReservoir {
+    vec3 lightPosition;
+    float weightSum;
+    vec3 lightNormal;
+    float sampleCount;
+    vec3 emission;
+    float contributionWeight;
+};
+
 struct MaterialProperties {
     vec3 albedo;
     vec3 emissive;
@@ -60,10 +206,15 @@ struct MaterialProperties {
     float roughness;
 };
 
-struct RayPayload {
-    vec3 radiance;
-    vec3 color;
-    vec2 pixelUV;
-    int depth;
-    uint randomSeed;
+// Filled by the closest hit shader, the raygen shader owns the path and does all the sampling
+struct HitPayload {
+    vec3 position;
+    float hitDistance; // Negative when the ray missed
+    vec3 normal;
+    float roughness;
+    vec3 albedo;
+    float metallic;
+    vec3 emissive;
+    float transmission;
+    float indexOfRefraction;
 };
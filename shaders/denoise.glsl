@@ -0,0 +1,28 @@
+// Edge stopping shared by the raygen shader and the denoiser passes, SVGF style (Schied et al.
+// 2017). Expects luminance from pbr.glsl
+
+// Relative depth change tolerated per pixel of distance
+const float DenoiseDepthSigma = 0.01;
+const float DenoiseNormalPower = 128.0;
+const float DenoiseLuminanceSigma = 4.0;
+// Below this many accumulated samples the variance is estimated spatially
+const float DenoiseFullHistory = 4.0;
+const float MinDemodulationAlbedo = 0.01;
+
+// Misses and directly visible emitters are left alone, the alpha of the albedo AOV flags emitters
+bool isFilterable(const vec4 albedo, const vec4 normalDepth) {
+    return normalDepth.w >= 0.0f && albedo.a < 0.5f;
+}
+
+// The filter works on illumination so texture detail isn't blurred away
+vec3 demodulationAlbedo(const vec4 albedo, const vec4 normalDepth) {
+    return isFilterable(albedo, normalDepth) ? max(albedo.rgb, vec3(MinDemodulationAlbedo))
+                                             : vec3(1.0f);
+}
+
+float geometryWeight(const vec4 center, const vec4 neighbor, const float pixelDistance) {
+    const float normalWeight = pow(max(dot(center.xyz, neighbor.xyz), 0.0f), DenoiseNormalPower);
+    const float depthWeight = exp(
+        -abs(center.w - neighbor.w) / (DenoiseDepthSigma * center.w * pixelDistance + 1e-4f));
+    return normalWeight * depthWeight;
+}
@@ -0,0 +1,192 @@
+// Expects the shader to declare topLevelAS, the emissiveTriangles, lights and environment buffers,
+// the sky texture and the shadowVisibility payload before including it
+#include "lights.glsl"
+#include "environment.glsl"
+
+// Solid angle pdf light sampling would pick a point on an emissive surface with. Triangles are
+// picked proportionally to area x luminance and then uniformly by area, so the area cancels out
+float emissiveLightPdf(const vec3 emission, const float hitDistance, const float cosLight) {
+    return luminance(emission) / emissiveTriangles.totalPower * hitDistance * hitDistance /
+           max(cosLight, 1e-6f);
+}
+
+// Direct light from one emissive triangle, weighted against BRDF sampling with the power heuristic
+// when the path also continues with a BRDF sample
+vec3 sampleDirectLight(
+    const vec3 origin,
+    const vec3 normal,
+    const vec3 toView,
+    const MaterialProperties material,
+    const vec4 u,
+    const bool weightAgainstBrdf) {
+    const LightSample lightSample = sampleEmissiveTriangle(emissiveTriangles.triangleCount, u);
+
+    const vec3 toLight = lightSample.position - origin;
+    const float distanceSquared = dot(toLight, toLight);
+    const float lightDistance = sqrt(distanceSquared);
+    const vec3 lightDirection = toLight / lightDistance;
+    const float cosLight = abs(dot(lightSample.normal, lightDirection));
+    if (cosLight <= 0.0f) {
+        return vec3(0.0f);
+    }
+    float brdfPdf;
+    const vec3 brdfCos = evaluateBRDF(material, normal, toView, lightDirection, brdfPdf);
+    if (brdfPdf <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    // Any hit occludes, the shadow miss shader is the only thing that marks it visible
+    shadowVisibility = 0.0f;
+    traceRayEXT(
+        topLevelAS,
+        gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT |
+            gl_RayFlagsSkipClosestHitShaderEXT,
+        AllMask,
+        DefaultSBTOffset,
+        DefaultSBTStride,
+        ShadowMissIndex,
+        origin,
+        TMin,
+        lightDirection,
+        lightDistance - Bias,
+        ShadowPayloadIndex);
+
+    const float lightPdf = lightSample.pdf * distanceSquared / cosLight;
+    const float misWeight = weightAgainstBrdf ? powerHeuristic(lightPdf, brdfPdf) : 1.0f;
+    return lightSample.emission * brdfCos * shadowVisibility * misWeight / lightPdf;
+}
+
+// Direct light from one importance sampled environment map direction, weighted like
+// sampleDirectLight
+vec3 sampleEnvironmentLight(
+    const vec3 origin,
+    const vec3 normal,
+    const vec3 toView,
+    const MaterialProperties material,
+    const vec4 u,
+    const bool weightAgainstBrdf) {
+    const EnvironmentSample environmentSample = sampleEnvironment(u);
+    if (environmentSample.pdf <= 0.0f) {
+        return vec3(0.0f);
+    }
+    float brdfPdf;
+    const vec3 brdfCos =
+        evaluateBRDF(material, normal, toView, environmentSample.direction, brdfPdf);
+    if (brdfPdf <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    shadowVisibility = 0.0f;
+    traceRayEXT(
+        topLevelAS,
+        gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT |
+            gl_RayFlagsSkipClosestHitShaderEXT,
+        AllMask,
+        DefaultSBTOffset,
+        DefaultSBTStride,
+        ShadowMissIndex,
+        origin,
+        TMin,
+        environmentSample.direction,
+        TMax,
+        ShadowPayloadIndex);
+
+    const float misWeight =
+        weightAgainstBrdf ? powerHeuristic(environmentSample.pdf, brdfPdf) : 1.0f;
+    return environmentSample.radiance * brdfCos * shadowVisibility * misWeight /
+           environmentSample.pdf;
+}
+
+// One analytic light picked uniformly, delta lights can't be reached by a bounce so this is their
+// only contribution and needs no MIS. Shadow rays ignore refractive instances
+vec3 sampleAnalyticLight(
+    const vec3 origin,
+    const vec3 normal,
+    const vec3 toView,
+    const MaterialProperties material,
+    const float u) {
+    const uint lightCount = lights.lightCount;
+    const uint lightIndex = min(uint(u * float(lightCount)), lightCount - 1);
+    const Light light = lights.values[lightIndex];
+
+    vec3 lightDirection;
+    float lightDistance;
+    float irradiance;
+    if (light.type == LightTypeDirectional) {
+        lightDirection = -normalize(light.directionOrPosition);
+        lightDistance = TMax;
+        irradiance = light.intensity;
+    } else {
+        const vec3 toLight = light.directionOrPosition - origin;
+        const float distanceSquared = dot(toLight, toLight);
+        lightDistance = sqrt(distanceSquared);
+        lightDirection = toLight / lightDistance;
+        irradiance = light.intensity / distanceSquared;
+        lightDistance -= Bias;
+    }
+
+    float brdfPdf;
+    const vec3 brdfCos = evaluateBRDF(material, normal, toView, lightDirection, brdfPdf);
+    if (brdfPdf <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    shadowVisibility = 0.0f;
+    traceRayEXT(
+        topLevelAS,
+        gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT |
+            gl_RayFlagsSkipClosestHitShaderEXT,
+        OpaqueMask,
+        DefaultSBTOffset,
+        DefaultSBTStride,
+        ShadowMissIndex,
+        origin,
+        TMin,
+        lightDirection,
+        lightDistance,
+        ShadowPayloadIndex);
+
+    return brdfCos * irradiance * shadowVisibility * float(lightCount);
+}
+
+// Direct light from the emitter point a ReSTIR reservoir settled on, weighted by the reservoir's
+// contribution weight. The reservoir stands in for all emissive triangles, BRDF samples that hit an
+// emitter afterwards must not add its emission again
+vec3 sampleReservoirLight(
+    const vec3 origin,
+    const vec3 normal,
+    const vec3 toView,
+    const MaterialProperties material,
+    const ReSTIRReservoir reservoir) {
+    if (reservoir.contributionWeight <= 0.0f) {
+        return vec3(0.0f);
+    }
+    const vec3 toLight = reservoir.lightPosition - origin;
+    const float distanceSquared = dot(toLight, toLight);
+    const float lightDistance = sqrt(distanceSquared);
+    const vec3 lightDirection = toLight / lightDistance;
+    const float cosLight = abs(dot(reservoir.lightNormal, lightDirection));
+    float brdfPdf;
+    const vec3 brdfCos = evaluateBRDF(material, normal, toView, lightDirection, brdfPdf);
+    if (brdfPdf <= 0.0f || cosLight <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    shadowVisibility = 0.0f;
+    traceRayEXT(
+        topLevelAS,
+        gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT |
+            gl_RayFlagsSkipClosestHitShaderEXT,
+        AllMask,
+        DefaultSBTOffset,
+        DefaultSBTStride,
+        ShadowMissIndex,
+        origin,
+        TMin,
+        lightDirection,
+        lightDistance - Bias,
+        ShadowPayloadIndex);
+
+    return reservoir.emission * brdfCos * cosLight / distanceSquared * shadowVisibility *
+           reservoir.contributionWeight;
+}
@@ -0,0 +1,70 @@
+// Expects the shader to declare the environment buffer and the baked sky texture before including
+// it
+#include "octahedral.glsl"
+
+struct EnvironmentSample {
+    vec3 direction;
+    vec3 radiance;
+    // Probability density with respect to solid angle
+    float pdf;
+};
+
+// Equirectangular layout, u goes around the up axis and v from straight up to straight down
+vec2 environmentDirectionToUv(const vec3 direction) {
+    return vec2(
+        atan(direction.z, direction.x) / (2.0f * Pi) + 0.5f,
+        acos(clamp(direction.y, -1.0f, 1.0f)) / Pi);
+}
+
+uint environmentTexelIndex(const vec3 direction) {
+    const uvec2 size = uvec2(environment.header.width, environment.header.height);
+    const uvec2 texel = min(uvec2(environmentDirectionToUv(direction) * vec2(size)), size - 1);
+    return texel.y * size.x + texel.x;
+}
+
+vec3 environmentRadiance(const vec3 direction) {
+    if (environment.header.type == EnvironmentTypeMap) {
+        return environment.texels[environmentTexelIndex(direction)].radiance *
+               environment.header.intensity;
+    }
+    // Ray tracing stages have no derivatives, the baked sky has a single level anyway
+    return textureLod(skyTexture, octahedralEncode(direction), 0.0f).rgb *
+           environment.header.intensity;
+}
+
+// A texel is picked with its selection probability and then uniformly in uv, the density over
+// the sphere divides that by the texel's solid angle
+float environmentTexelPdf(const float selectionProbability, const float sinTheta) {
+    const float texelCount = float(environment.header.width * environment.header.height);
+    return selectionProbability * texelCount / (2.0f * Pi * Pi * max(sinTheta, 1e-6f));
+}
+
+// Only maps can be sampled, the procedural sky is left to BRDF sampling
+float environmentPdf(const vec3 direction) {
+    const float sinTheta = sqrt(max(1.0f - direction.y * direction.y, 0.0f));
+    return environmentTexelPdf(
+        environment.texels[environmentTexelIndex(direction)].selectionProbability,
+        sinTheta);
+}
+
+// Alias table lookup for the texel, the other two numbers place the direction inside it
+EnvironmentSample sampleEnvironment(const vec4 u) {
+    const uint width = environment.header.width;
+    const uint texelCount = width * environment.header.height;
+    const uint candidate = min(uint(u.x * float(texelCount)), texelCount - 1);
+    const EnvironmentTexel candidateTexel = environment.texels[candidate];
+    const uint index = u.y < candidateTexel.aliasProbability ? candidate : candidateTexel.alias;
+    const EnvironmentTexel texel = environment.texels[index];
+
+    const vec2 uv = (vec2(index % width, index / width) + u.zw) /
+                    vec2(width, environment.header.height);
+    const float phi = (uv.x - 0.5f) * 2.0f * Pi;
+    const float theta = uv.y * Pi;
+    const float sinTheta = sin(theta);
+
+    EnvironmentSample environmentSample;
+    environmentSample.direction = vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+    environmentSample.radiance = texel.radiance * environment.header.intensity;
+    environmentSample.pdf = environmentTexelPdf(texel.selectionProbability, sinTheta);
+    return environmentSample;
+}
@@ -0,0 +1,34 @@
+// Expects the shader to declare the emissiveTriangles buffer before including it
+struct LightSample {
+    vec3 position;
+    vec3 normal;
+    vec3 emission;
+    // Probability density with respect to area on the light
+    float pdf;
+};
+
+// Alias table lookup, one uniform number picks the column and a second one the column's alias
+uint sampleAliasTable(const uint triangleCount, const float u0, const float u1) {
+    const uint index = min(uint(u0 * float(triangleCount)), triangleCount - 1);
+    const EmissiveTriangle candidate = emissiveTriangles.values[index];
+    return u1 < candidate.aliasProbability ? index : candidate.alias;
+}
+
+LightSample sampleEmissiveTriangle(const uint triangleCount, const vec4 u) {
+    const EmissiveTriangle triangle =
+        emissiveTriangles.values[sampleAliasTable(triangleCount, u.x, u.y)];
+
+    // Uniform point on the triangle
+    const float su = sqrt(u.z);
+    const float b0 = 1.0f - su;
+    const float b1 = u.w * su;
+    const vec3 edge0 = triangle.v1 - triangle.v0;
+    const vec3 edge1 = triangle.v2 - triangle.v0;
+
+    LightSample lightSample;
+    lightSample.position = triangle.v0 + edge0 * b1 + edge1 * (1.0f - b0 - b1);
+    lightSample.normal = normalize(cross(edge0, edge1));
+    lightSample.emission = triangle.emission;
+    lightSample.pdf = triangle.selectionProbability / triangle.area;
+    return lightSample;
+}
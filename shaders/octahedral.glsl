@@ -0,0 +1,20 @@
+// Octahedral mapping of the unit sphere to [0, 1]^2 around the up (+Y) axis. The upper hemisphere
+// fills the inner diamond and the lower one is folded over the corners
+vec2 octahedralEncode(const vec3 direction) {
+    const vec3 n = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    vec2 p = n.xz;
+    if (n.y < 0.0f) {
+        const vec2 signs = mix(vec2(-1.0f), vec2(1.0f), greaterThanEqual(p, vec2(0.0f)));
+        p = (1.0f - abs(p.yx)) * signs;
+    }
+    return p * 0.5f + 0.5f;
+}
+
+vec3 octahedralDecode(const vec2 uv) {
+    const vec2 p = uv * 2.0f - 1.0f;
+    vec3 n = vec3(p.x, 1.0f - abs(p.x) - abs(p.y), p.y);
+    const float t = max(-n.y, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.z += n.z >= 0.0f ? -t : t;
+    return normalize(n);
+}
@@ -21,4 +21,161 @@ float fresnel(const vec3 I, const vec3 N, const float ior) {
                    ((etaIncident * cosIncident) + (etaTrans * cosTrans));
         return clamp((rS * rS + rP * rP) / 2.0f, 0.0f, 1.0f);
     }
-}
\ No newline at end of file
+}
+
+// Metallic-roughness BRDF: Lambert diffuse plus a GGX (Trowbridge-Reitz) specular lobe with
+// height-correlated Smith shadowing. Directions point away from the surface
+const float MinGGXAlpha = 0.002;
+
+struct BSDFSample {
+    vec3 direction;
+    // BRDF x cosine over pdf
+    vec3 weight;
+    // Solid angle pdf of the lobe mixture
+    float pdf;
+};
+
+float luminance(const vec3 color) {
+    return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+float powerHeuristic(const float pdf, const float otherPdf) {
+    const float pdfSquared = pdf * pdf;
+    return pdfSquared / max(pdfSquared + otherPdf * otherPdf, 1e-12f);
+}
+
+void buildOrthonormalBasis(const vec3 normal, out vec3 tangent, out vec3 bitangent) {
+    // Duff et al. 2017, Building an Orthonormal Basis, Revisited
+    const float zSign = normal.z >= 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (zSign + normal.z);
+    const float b = normal.x * normal.y * a;
+    tangent = vec3(1.0f + zSign * normal.x * normal.x * a, zSign * b, -zSign * normal.x);
+    bitangent = vec3(b, zSign + normal.y * normal.y * a, -normal.y);
+}
+
+vec3 fresnelSchlick(const vec3 f0, const float cosTheta) {
+    return f0 + (1.0f - f0) * pow(clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
+}
+
+float ggxDistribution(const float nDotH, const float alpha) {
+    const float alphaSquared = alpha * alpha;
+    const float d = nDotH * nDotH * (alphaSquared - 1.0f) + 1.0f;
+    return alphaSquared / (Pi * d * d);
+}
+
+float smithLambda(const float nDotX, const float alpha) {
+    const float cosSquared = nDotX * nDotX;
+    const float tanSquared = max(1.0f - cosSquared, 0.0f) / max(cosSquared, 1e-7f);
+    return 0.5f * (-1.0f + sqrt(1.0f + alpha * alpha * tanSquared));
+}
+
+float smithG1(const float nDotX, const float alpha) {
+    return 1.0f / (1.0f + smithLambda(nDotX, alpha));
+}
+
+float smithG2(const float nDotV, const float nDotL, const float alpha) {
+    return 1.0f / (1.0f + smithLambda(nDotV, alpha) + smithLambda(nDotL, alpha));
+}
+
+// Heitz 2018, Sampling the GGX Distribution of Visible Normals. The view direction is in the
+// local frame where the normal is +Z, returns the sampled microfacet normal in the same frame
+vec3 sampleGGXVNDF(const vec3 viewLocal, const float alpha, const vec2 u) {
+    const vec3 hemisphereView =
+        normalize(vec3(alpha * viewLocal.x, alpha * viewLocal.y, viewLocal.z));
+    const float lengthSquared = dot(hemisphereView.xy, hemisphereView.xy);
+    const vec3 t1 = lengthSquared > 0.0f
+                        ? vec3(-hemisphereView.y, hemisphereView.x, 0.0f) * inversesqrt(lengthSquared)
+                        : vec3(1.0f, 0.0f, 0.0f);
+    const vec3 t2 = cross(hemisphereView, t1);
+
+    const float r = sqrt(u.x);
+    const float phi = 2.0f * Pi * u.y;
+    const float p1 = r * cos(phi);
+    const float s = 0.5f * (1.0f + hemisphereView.z);
+    const float p2 = (1.0f - s) * sqrt(max(1.0f - p1 * p1, 0.0f)) + s * r * sin(phi);
+    const vec3 hemisphereNormal =
+        p1 * t1 + p2 * t2 + sqrt(max(1.0f - p1 * p1 - p2 * p2, 0.0f)) * hemisphereView;
+    return normalize(vec3(
+        alpha * hemisphereNormal.x,
+        alpha * hemisphereNormal.y,
+        max(hemisphereNormal.z, 0.0f)));
+}
+
+float roughnessToAlpha(const float roughness) {
+    return max(roughness * roughness, MinGGXAlpha);
+}
+
+// Lobe selection follows the expected contribution of each lobe seen from the view direction
+float specularProbability(const MaterialProperties material, const float nDotV) {
+    const vec3 f0 = mix(vec3(0.04f), material.albedo, material.metallic);
+    const float specular = luminance(fresnelSchlick(f0, nDotV));
+    const float diffuse = luminance(material.albedo) * (1.0f - material.metallic);
+    return specular / max(specular + diffuse, 1e-4f);
+}
+
+// Returns BRDF x cosine and the pdf sampleBRDF would generate toLight with
+vec3 evaluateBRDF(
+    const MaterialProperties material,
+    const vec3 normal,
+    const vec3 toView,
+    const vec3 toLight,
+    out float pdf) {
+    pdf = 0.0f;
+    const float nDotL = dot(normal, toLight);
+    const float nDotV = dot(normal, toView);
+    if (nDotL <= 0.0f || nDotV <= 0.0f) {
+        return vec3(0.0f);
+    }
+
+    const vec3 halfVector = normalize(toView + toLight);
+    const float nDotH = max(dot(normal, halfVector), 0.0f);
+    const float vDotH = max(dot(toView, halfVector), 0.0f);
+    const float alpha = roughnessToAlpha(material.roughness);
+
+    const vec3 f0 = mix(vec3(0.04f), material.albedo, material.metallic);
+    const vec3 fresnelTerm = fresnelSchlick(f0, vDotH);
+    const float distribution = ggxDistribution(nDotH, alpha);
+    const vec3 specular =
+        fresnelTerm * distribution * smithG2(nDotV, nDotL, alpha) / (4.0f * nDotV * nDotL);
+    const vec3 diffuse = (1.0f - fresnelTerm) * (1.0f - material.metallic) * material.albedo / Pi;
+
+    const float specularPdf = distribution * smithG1(nDotV, alpha) / (4.0f * nDotV);
+    const float diffusePdf = nDotL / Pi;
+    const float pSpecular = specularProbability(material, nDotV);
+    pdf = mix(diffusePdf, specularPdf, pSpecular);
+
+    return (diffuse + specular) * nDotL;
+}
+
+BSDFSample sampleBRDF(
+    const MaterialProperties material,
+    const vec3 normal,
+    const vec3 toView,
+    const vec3 u) {
+    vec3 tangent, bitangent;
+    buildOrthonormalBasis(normal, tangent, bitangent);
+
+    const float nDotV = dot(normal, toView);
+    vec3 direction;
+    if (u.z < specularProbability(material, nDotV)) {
+        const vec3 viewLocal =
+            vec3(dot(toView, tangent), dot(toView, bitangent), dot(toView, normal));
+        const vec3 microfacetNormal =
+            sampleGGXVNDF(viewLocal, roughnessToAlpha(material.roughness), u.xy);
+        const vec3 halfVector = microfacetNormal.x * tangent + microfacetNormal.y * bitangent +
+                                microfacetNormal.z * normal;
+        direction = reflect(-toView, halfVector);
+    } else {
+        const float phi = 2.0f * Pi * u.x;
+        const float cosTheta = sqrt(1.0f - u.y);
+        const float sinTheta = sqrt(u.y);
+        direction = sinTheta * cos(phi) * tangent + sinTheta * sin(phi) * bitangent +
+                    cosTheta * normal;
+    }
+
+    BSDFSample bsdfSample;
+    bsdfSample.direction = direction;
+    const vec3 value = evaluateBRDF(material, normal, toView, direction, bsdfSample.pdf);
+    bsdfSample.weight = bsdfSample.pdf > 0.0f ? value / bsdfSample.pdf : vec3(0.0f);
+    return bsdfSample;
+}
@@ -0,0 +1,45 @@
+// Probe addressing shared by the probe passes and the shaders that sample the probes. Probe
+// (x, y, z) owns atlas tile (x + z * dimensions.x, y) and ray image row probeIndex(x, y, z)
+#include "octahedral.glsl"
+
+uint probeIndex(const ProbeGridData grid, const uvec3 coords) {
+    return coords.x + grid.dimensions.x * (coords.y + grid.dimensions.y * coords.z);
+}
+
+uvec3 probeCoords(const ProbeGridData grid, const uint index) {
+    return uvec3(
+        index % grid.dimensions.x,
+        (index / grid.dimensions.x) % grid.dimensions.y,
+        index / (grid.dimensions.x * grid.dimensions.y));
+}
+
+vec3 probePosition(const ProbeGridData grid, const uvec3 coords) {
+    return grid.origin + grid.spacing * vec3(coords);
+}
+
+uvec2 probeTile(const ProbeGridData grid, const uvec3 coords) {
+    return uvec2(coords.x + coords.z * grid.dimensions.x, coords.y);
+}
+
+// Atlas coordinates of direction inside the probe's tile, kept off the border texels
+vec2 probeAtlasUv(
+    const ProbeGridData grid,
+    const uvec3 coords,
+    const vec3 direction,
+    const uint resolution) {
+    const vec2 atlasSize =
+        vec2(grid.dimensions.x * grid.dimensions.z, grid.dimensions.y) * float(resolution);
+    const vec2 tileOrigin = vec2(probeTile(grid, coords) * resolution);
+    const vec2 texel = tileOrigin + 1.0f + octahedralEncode(direction) * float(resolution - 2);
+    return texel / atlasSize;
+}
+
+// Evenly spread directions over the sphere (Keinert et al. 2015), every probe traces the same set
+// under a per frame rotation
+vec3 sphericalFibonacci(const uint index, const uint count) {
+    const float GoldenRatio = 1.61803398875f;
+    const float phi = 2.0f * Pi * fract(float(index) * (GoldenRatio - 1.0f));
+    const float cosTheta = 1.0f - (2.0f * float(index) + 1.0f) / float(count);
+    const float sinTheta = sqrt(clamp(1.0f - cosTheta * cosTheta, 0.0f, 1.0f));
+    return vec3(cos(phi) * sinTheta, cosTheta, sin(phi) * sinTheta);
+}
@@ -0,0 +1,70 @@
+// Expects the shader to declare the probeGrid block and the irradiance and visibility atlases
+// before including it
+#include "probeGrid.glsl"
+
+// Chebyshev weights below this are crushed further, light leaking through thin walls mostly comes
+// from probes that are barely visible
+const float ProbeVisibilityCrush = 0.2f;
+
+// Irradiance over pi arriving at a surface, blended from the eight surrounding probes. Each one is
+// weighted by trilinear distance, by how much it faces the surface and by the chance it can see
+// the surface according to its depth moments (Majercik et al. 2019). Lambertian outgoing radiance
+// is the diffuse albedo times the result
+vec3 sampleProbeIrradiance(const vec3 position, const vec3 normal, const vec3 toView) {
+    const ProbeGridData grid = probeGrid.data;
+    // Pushing the lookup off the surface keeps probes behind it from shadowing it
+    const vec3 biasedPosition = position + (normal * 0.2f + toView * 0.8f) * grid.normalBias;
+    const vec3 lastProbe = vec3(grid.dimensions - 1u);
+    const vec3 gridPosition =
+        clamp((biasedPosition - grid.origin) / grid.spacing, vec3(0.0f), lastProbe);
+    const uvec3 baseCoords = uvec3(min(floor(gridPosition), max(lastProbe - 1.0f, vec3(0.0f))));
+    const vec3 alpha = clamp(gridPosition - vec3(baseCoords), vec3(0.0f), vec3(1.0f));
+
+    vec3 irradianceSum = vec3(0.0f);
+    float weightSum = 0.0f;
+    for (uint corner = 0; corner < 8; corner += 1) {
+        const uvec3 offset = uvec3(corner & 1u, (corner >> 1) & 1u, (corner >> 2) & 1u);
+        const uvec3 coords = min(baseCoords + offset, grid.dimensions - 1u);
+        const vec3 probe = probePosition(grid, coords);
+
+        // Wrap shading, probes behind the surface still count a little so the blend stays smooth
+        const vec3 toProbe = normalize(probe - position);
+        const float facing = (dot(toProbe, normal) + 1.0f) * 0.5f;
+        float weight = facing * facing + 0.2f;
+
+        const vec3 probeToPoint = biasedPosition - probe;
+        const float pointDistance = length(probeToPoint);
+        const vec2 moments = textureLod(
+                                 visibilityTexture,
+                                 probeAtlasUv(
+                                     grid,
+                                     coords,
+                                     probeToPoint / max(pointDistance, 1e-4f),
+                                     ProbeVisibilityResolution),
+                                 0.0f)
+                                 .xy;
+        if (pointDistance > moments.x) {
+            const float variance = abs(moments.x * moments.x - moments.y);
+            const float excess = pointDistance - moments.x;
+            const float chebyshev = variance / (variance + excess * excess);
+            weight *= chebyshev * chebyshev * chebyshev;
+        }
+        weight = max(weight, 1e-6f);
+        if (weight < ProbeVisibilityCrush) {
+            weight *= weight * weight / (ProbeVisibilityCrush * ProbeVisibilityCrush);
+        }
+
+        const vec3 trilinear = mix(1.0f - alpha, alpha, vec3(offset));
+        weight *= trilinear.x * trilinear.y * trilinear.z;
+
+        const vec3 irradiance =
+            textureLod(
+                irradianceTexture,
+                probeAtlasUv(grid, coords, normal, ProbeIrradianceResolution),
+                0.0f)
+                .rgb;
+        irradianceSum += irradiance * weight;
+        weightSum += weight;
+    }
+    return weightSum > 0.0f ? irradianceSum / weightSum : vec3(0.0f);
+}
@@ -0,0 +1,81 @@
+// Expects the shader to declare the radianceCache buffer and the camera properties, and to include
+// sampler.glsl for its hashes, before including it
+
+const uint RadianceCacheInvalidSlot = MaxUInt;
+
+// Where a cell lives in the table and the checksum that tells it apart from other cells hashed to
+// the same slots
+struct RadianceCacheKey {
+    uint slot;
+    uint checksum;
+};
+
+RadianceCacheKey radianceCacheKey(const vec3 position, const vec3 normal) {
+    const vec3 cameraPosition = cameraProperties.viewInverse[3].xyz;
+    const float cameraDistance = distance(position, cameraPosition);
+    const uint level = uint(clamp(
+        log2(max(cameraDistance / RadianceCacheLodDistance, 1.0f)),
+        0.0f,
+        float(RadianceCacheMaxLevel)));
+    const ivec3 cell = ivec3(floor(position / (RadianceCacheCellSize * exp2(float(level)))));
+    // Dominant axis and sign of the normal, so the walls meeting at a corner don't share a cell
+    const vec3 absNormal = abs(normal);
+    const uint axis = absNormal.x > absNormal.y ? (absNormal.x > absNormal.z ? 0 : 2)
+                                                : (absNormal.y > absNormal.z ? 1 : 2);
+    const uint normalBits = axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+    const uint levelAndNormal = level * 8 + normalBits;
+
+    uint slotHash = hashCombine(hashUint(uint(cell.x)), uint(cell.y));
+    slotHash = hashCombine(slotHash, uint(cell.z));
+    slotHash = hashCombine(slotHash, levelAndNormal);
+    // A second, differently seeded chain, zero is reserved for free slots
+    uint checksum = hashCombine(hashUint(uint(cell.x) ^ 0x5bd1e995u), uint(cell.y));
+    checksum = hashCombine(checksum, uint(cell.z));
+    checksum = hashCombine(checksum, levelAndNormal);
+    return RadianceCacheKey(slotHash % RadianceCacheCapacity, max(checksum, 1u));
+}
+
+// Cached outgoing radiance of the cell around position, false when the cell is missing or hasn't
+// averaged enough samples yet. Eviction can leave holes in front of a cell, so every probe step is
+// checked
+bool radianceCacheLookup(const vec3 position, const vec3 normal, out vec3 radiance) {
+    const RadianceCacheKey key = radianceCacheKey(position, normal);
+    for (uint step = 0; step < RadianceCacheProbeSteps; step += 1) {
+        const uint slot = (key.slot + step) % RadianceCacheCapacity;
+        if (radianceCache.entries[slot].checksum == key.checksum) {
+            radiance = radianceCache.entries[slot].radiance;
+            return radianceCache.entries[slot].sampleCount >= RadianceCacheMinSamples;
+        }
+    }
+    radiance = vec3(0.0f);
+    return false;
+}
+
+// Slot of the cell around position, claiming a free one if the cell isn't in the table yet.
+// RadianceCacheInvalidSlot when every probed slot belongs to another cell
+uint radianceCacheInsert(const vec3 position, const vec3 normal) {
+    const RadianceCacheKey key = radianceCacheKey(position, normal);
+    for (uint step = 0; step < RadianceCacheProbeSteps; step += 1) {
+        const uint slot = (key.slot + step) % RadianceCacheCapacity;
+        const uint previous = atomicCompSwap(radianceCache.entries[slot].checksum, 0, key.checksum);
+        if (previous == 0 || previous == key.checksum) {
+            return slot;
+        }
+    }
+    return RadianceCacheInvalidSlot;
+}
+
+// Adds one sample of outgoing radiance to a slot, Resolve averages it in at the end of the frame.
+// Samples past the cell's per frame cap are counted but dropped
+void radianceCacheAccumulate(const uint slot, const vec3 radiance) {
+    if (atomicAdd(radianceCache.entries[slot].accumulatedCount, 1) >=
+        RadianceCacheMaxFrameSamples) {
+        return;
+    }
+    const uvec3 fixedPoint =
+        uvec3(clamp(radiance, vec3(0.0f), vec3(RadianceCacheMaxRadiance)) *
+              RadianceCacheFixedPointScale);
+    atomicAdd(radianceCache.entries[slot].accumulatedRed, fixedPoint.r);
+    atomicAdd(radianceCache.entries[slot].accumulatedGreen, fixedPoint.g);
+    atomicAdd(radianceCache.entries[slot].accumulatedBlue, fixedPoint.b);
+}
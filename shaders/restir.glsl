@@ -0,0 +1,114 @@
+// Expects the shader to include pbr.glsl and sampler.glsl before including it
+//
+// Reservoir-based spatiotemporal importance resampling of direct light from emissive triangles
+// (Bitterli et al. 2020). Every pixel resamples many light candidates into one reservoir, then
+// merges it with its own reservoir from last frame and with those of a few similar neighbors. The
+// target function is the unshadowed contribution, so shading casts a single shadow ray for the
+// sample that wins. Reservoirs are normalized by their candidate count, the biased variant
+
+// Candidates drawn from the light alias table per pixel and frame
+const uint ReSTIRCandidateCount = 32;
+// Last frame's reservoir counts for at most this many times the current one, so stale samples
+// can't dominate after lighting changes
+const float ReSTIRTemporalMaxSampleRatio = 20.0f;
+const uint ReSTIRSpatialSampleCount = 4;
+const float ReSTIRSpatialRadius = 16.0f;
+// Relative depth and normal tolerance a neighbor or reprojected pixel has to fall within
+const float ReSTIRDepthTolerance = 0.1f;
+const float ReSTIRNormalThreshold = 0.9f;
+
+ReSTIRReservoir emptyReservoir() {
+    return ReSTIRReservoir(vec3(0.0f), 0.0f, vec3(0.0f), 0.0f, vec3(0.0f), 0.0f);
+}
+
+// Resampling decisions don't need low discrepancy, a hashed sequence per pixel, frame and pass
+// keeps them out of the sampler's dimensions
+uint restirSeed(const uvec2 pixel, const uint frameIndex, const uint pass) {
+    return hashCombine(hashCombine(hashUint(pixel.x), pixel.y), frameIndex * 4 + pass);
+}
+
+float restirRandom(inout uint state) {
+    state = state * 747796405u + 2891336453u;
+    return uintToUnitFloat(hashUint(state));
+}
+
+MaterialProperties surfaceMaterial(const ReSTIRSurface surface) {
+    return MaterialProperties(surface.albedo, vec3(0.0f), surface.metallic, surface.roughness);
+}
+
+// Unshadowed light a point on an emitter sends towards the view through the surface, with respect
+// to area on the emitter
+vec3 restirContribution(
+    const ReSTIRSurface surface,
+    const vec3 lightPosition,
+    const vec3 lightNormal,
+    const vec3 emission) {
+    const vec3 toLight = lightPosition - surface.position;
+    const float distanceSquared = dot(toLight, toLight);
+    if (distanceSquared <= 0.0f) {
+        return vec3(0.0f);
+    }
+    const vec3 lightDirection = toLight * inversesqrt(distanceSquared);
+    const float cosLight = abs(dot(lightNormal, lightDirection));
+    float brdfPdf;
+    const vec3 brdfCos = evaluateBRDF(
+        surfaceMaterial(surface),
+        surface.normal,
+        surface.toView,
+        lightDirection,
+        brdfPdf);
+    return emission * brdfCos * cosLight / distanceSquared;
+}
+
+float restirTargetPdf(const ReSTIRSurface surface, const ReSTIRReservoir reservoir) {
+    return luminance(restirContribution(
+        surface,
+        reservoir.lightPosition,
+        reservoir.lightNormal,
+        reservoir.emission));
+}
+
+// Streams one candidate into the reservoir, weight is its target pdf over its source pdf
+void restirAddCandidate(
+    inout ReSTIRReservoir reservoir,
+    const vec3 lightPosition,
+    const vec3 lightNormal,
+    const vec3 emission,
+    const float weight,
+    const float u) {
+    reservoir.weightSum += weight;
+    reservoir.sampleCount += 1.0f;
+    if (weight > 0.0f && u * reservoir.weightSum < weight) {
+        reservoir.lightPosition = lightPosition;
+        reservoir.lightNormal = lightNormal;
+        reservoir.emission = emission;
+    }
+}
+
+// Merges another finalized reservoir, targetPdf is its sample's target pdf at this reservoir's
+// surface
+void restirMerge(
+    inout ReSTIRReservoir reservoir,
+    const ReSTIRReservoir other,
+    const float targetPdf,
+    const float u) {
+    const float weight = targetPdf * other.contributionWeight * other.sampleCount;
+    reservoir.weightSum += weight;
+    reservoir.sampleCount += other.sampleCount;
+    if (weight > 0.0f && u * reservoir.weightSum < weight) {
+        reservoir.lightPosition = other.lightPosition;
+        reservoir.lightNormal = other.lightNormal;
+        reservoir.emission = other.emission;
+    }
+}
+
+void restirFinalize(inout ReSTIRReservoir reservoir, const ReSTIRSurface surface) {
+    const float targetPdf = restirTargetPdf(surface, reservoir);
+    reservoir.contributionWeight = targetPdf > 0.0f && reservoir.sampleCount > 0.0f
+                                       ? reservoir.weightSum / (reservoir.sampleCount * targetPdf)
+                                       : 0.0f;
+}
+
+bool restirSimilarDepth(const float depth, const float otherDepth) {
+    return otherDepth >= 0.0f && abs(depth - otherDepth) <= ReSTIRDepthTolerance * depth;
+}
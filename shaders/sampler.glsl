@@ -0,0 +1,93 @@
+// Expects the shader to declare the samplerTables buffer before including it
+//
+// Every draw takes four dimensions at once. Sobol mode follows Burley's "Practical Hash-based Owen
+// Scrambling" (JCGT 2020): a 4D Sobol point, Owen scrambled per pixel and per dimension, with the
+// sample index shuffled per dimension so higher dimensions are padded with decorrelated copies.
+// Blue noise mode offsets the host generated mask per dimension and walks it over time with the
+// golden ratio, it only stratifies across pixels and frames
+struct SamplerState {
+    uvec2 pixel;
+    uint pixelSeed;
+    uint sampleIndex;
+    uint mode;
+};
+
+const float GoldenRatioConjugate = 0.61803398875;
+
+// https://nullprogram.com/blog/2018/07/31/
+uint hashUint(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint hashCombine(const uint seed, const uint value) {
+    return seed ^ (hashUint(value) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// Keeps 24 bits so the result stays strictly below one
+float uintToUnitFloat(const uint x) {
+    return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+uint sobol(uint index, const uint dimension) {
+    uint result = 0;
+    for (uint bit = 0; index != 0; index >>= 1, bit += 1) {
+        if ((index & 1u) != 0) {
+            result ^= samplerTables.sobolDirections[dimension * SobolBits + bit];
+        }
+    }
+    return result;
+}
+
+uint laineKarrasPermutation(uint x, const uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Owen scrambling, every bit is flipped depending on all the bits above it
+uint nestedUniformScramble(const uint x, const uint seed) {
+    return bitfieldReverse(laineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+SamplerState createSampler(const uvec2 pixel, const uint sampleIndex, const uint mode) {
+    return SamplerState(pixel, hashUint(pixel.x ^ hashUint(pixel.y)), sampleIndex, mode);
+}
+
+float sampleBlueNoise(const SamplerState state, const uint dimension) {
+    const uint offsetSeed = hashUint(dimension);
+    const uvec2 texel = (state.pixel + uvec2(offsetSeed, offsetSeed >> 16)) % BlueNoiseSize;
+    const float value = samplerTables.blueNoise[texel.y * BlueNoiseSize + texel.x];
+    return fract(value + float(state.sampleIndex) * GoldenRatioConjugate);
+}
+
+// Four consecutive dimensions starting at 4 * dimensionGroup. Callers pick fixed groups so a
+// given decision always lands on the same dimensions, whichever branch the path took before
+vec4 sample4D(const SamplerState state, const uint dimensionGroup) {
+    if (state.mode == SamplerModeBlueNoise) {
+        const uint dimension = dimensionGroup * SobolDimensions;
+        return vec4(
+            sampleBlueNoise(state, dimension),
+            sampleBlueNoise(state, dimension + 1),
+            sampleBlueNoise(state, dimension + 2),
+            sampleBlueNoise(state, dimension + 3));
+    }
+
+    const uint groupSeed = hashCombine(state.pixelSeed, dimensionGroup);
+    const uint shuffledIndex = nestedUniformScramble(state.sampleIndex, groupSeed);
+    vec4 result;
+    for (uint dimension = 0; dimension < SobolDimensions; dimension += 1) {
+        const uint scrambled = nestedUniformScramble(
+            sobol(shuffledIndex, dimension),
+            hashCombine(groupSeed, dimension + 1));
+        result[dimension] = uintToUnitFloat(scrambled);
+    }
+    return result;
+}
@@ -0,0 +1,247 @@
+#include "BLASBuilder.h"
+
+#include <algorithm>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Mesh.h"
+#include "VulkanBuffer.h"
+
+#undef MemoryBarrier
+
+namespace VKRT {
+
+BLASBuilder::BLASBuilder(ScopedRefPtr<Context> context)
+    : mContext(context), mPendingMeshes(), mScratchBuffer(nullptr) {}
+
+void BLASBuilder::Enqueue(Mesh* mesh) {
+    if (mesh != nullptr) {
+        mPendingMeshes.emplace_back(mesh);
+    }
+}
+
+void BLASBuilder::EnsureScratchCapacity(vk::DeviceSize size) {
+    if (mScratchBuffer == nullptr || mScratchBuffer->GetBufferSize() < size) {
+        mScratchBuffer = mContext->GetDevice()->CreateBuffer(
+            size,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            vk::MemoryAllocateFlagBits::eDeviceAddress);
+    }
+}
+
+void BLASBuilder::Flush() {
+    if (!HasPendingBuilds()) {
+        return;
+    }
+
+    // Geometry uploads have to land, and be owned by the graphics queue, before the builds
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->Wait(uploadManager->Flush());
+
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    const vk::DeviceSize scratchAlignment =
+        device->GetAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment;
+    auto alignScratch = [scratchAlignment](vk::DeviceSize size) {
+        return (size + scratchAlignment - 1) & ~(scratchAlignment - 1);
+    };
+
+    // Split the queue into batches whose scratch regions fit side by side in the arena, every
+    // build inside a batch gets its own region so the driver is free to run them concurrently
+    struct Batch {
+        size_t begin;
+        size_t end;
+        vk::DeviceSize scratchSize;
+    };
+    std::vector<Batch> batches;
+    Batch currentBatch{.begin = 0, .end = 0, .scratchSize = 0};
+    vk::DeviceSize arenaSize = 0;
+    for (size_t meshIndex = 0; meshIndex < mPendingMeshes.size(); ++meshIndex) {
+        const vk::DeviceSize scratchSize =
+            alignScratch(mPendingMeshes[meshIndex]->GetBuildInput().scratchSize);
+        if (currentBatch.end > currentBatch.begin &&
+            currentBatch.scratchSize + scratchSize > MaxScratchArenaSize) {
+            arenaSize = std::max(arenaSize, currentBatch.scratchSize);
+            batches.push_back(currentBatch);
+            currentBatch = Batch{.begin = meshIndex, .end = meshIndex, .scratchSize = 0};
+        }
+        currentBatch.scratchSize += scratchSize;
+        currentBatch.end = meshIndex + 1;
+    }
+    arenaSize = std::max(arenaSize, currentBatch.scratchSize);
+    batches.push_back(currentBatch);
+
+    // Over allocate by one alignment unit, buffer addresses are not guaranteed to satisfy the
+    // scratch offset alignment on their own
+    EnsureScratchCapacity(arenaSize + scratchAlignment);
+    const vk::DeviceAddress scratchAddress = alignScratch(mScratchBuffer->GetDeviceAddress());
+
+    vk::CommandBuffer commandBuffer = device->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+
+    for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+        const Batch& batch = batches[batchIndex];
+        std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos;
+        std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRangeInfos;
+        buildInfos.reserve(batch.end - batch.begin);
+        buildRangeInfos.reserve(batch.end - batch.begin);
+
+        vk::DeviceSize scratchOffset = 0;
+        for (size_t meshIndex = batch.begin; meshIndex < batch.end; ++meshIndex) {
+            const Mesh::BuildInput& buildInput = mPendingMeshes[meshIndex]->GetBuildInput();
+            buildInfos.emplace_back(vk::AccelerationStructureBuildGeometryInfoKHR()
+                                        .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
+                                        .setFlags(buildInput.flags)
+                                        .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
+                                        .setDstAccelerationStructure(
+                                            mPendingMeshes[meshIndex]->GetBLAS())
+                                        .setGeometries(buildInput.geometry)
+                                        .setScratchData(scratchAddress + scratchOffset));
+            buildRangeInfos.push_back(&buildInput.range);
+            scratchOffset += alignScratch(buildInput.scratchSize);
+        }
+
+        commandBuffer.buildAccelerationStructuresKHR(
+            buildInfos,
+            buildRangeInfos,
+            device->GetDispatcher());
+
+        // The next batch reuses the same scratch memory
+        if (batchIndex + 1 < batches.size()) {
+            vk::MemoryBarrier barrier =
+                vk::MemoryBarrier()
+                    .setSrcAccessMask(vk::AccessFlagBits::eAccelerationStructureWriteKHR)
+                    .setDstAccessMask(
+                        vk::AccessFlagBits::eAccelerationStructureReadKHR |
+                        vk::AccessFlagBits::eAccelerationStructureWriteKHR);
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                {},
+                barrier,
+                {},
+                {});
+        }
+    }
+    VKRT_ASSERT_VK(commandBuffer.end());
+    device->SubmitCommandAndFlush(commandBuffer);
+    device->DestroyCommand(commandBuffer);
+
+    std::vector<Mesh*> compactedMeshes;
+    for (Mesh* mesh : mPendingMeshes) {
+        if (mesh->GetBuildInput().compact) {
+            compactedMeshes.push_back(mesh);
+        }
+    }
+    if (!compactedMeshes.empty()) {
+        Compact(compactedMeshes);
+    }
+
+    mPendingMeshes.clear();
+}
+
+void BLASBuilder::Compact(const std::vector<Mesh*>& meshes) {
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::Device& logicalDevice = device->GetLogicalDevice();
+    const uint32_t queryCount = static_cast<uint32_t>(meshes.size());
+
+    std::vector<vk::AccelerationStructureKHR> sourceStructures;
+    sourceStructures.reserve(meshes.size());
+    for (const Mesh* mesh : meshes) {
+        sourceStructures.push_back(mesh->GetBLAS());
+    }
+
+    vk::QueryPool queryPool = VKRT_ASSERT_VK(logicalDevice.createQueryPool(
+        vk::QueryPoolCreateInfo()
+            .setQueryType(vk::QueryType::eAccelerationStructureCompactedSizeKHR)
+            .setQueryCount(queryCount)));
+
+    {
+        vk::CommandBuffer commandBuffer = device->CreateCommandBuffer();
+        VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+        commandBuffer.resetQueryPool(queryPool, 0, queryCount);
+
+        // Make the builds from the previous submission visible to the size query and the copies
+        vk::MemoryBarrier barrier =
+            vk::MemoryBarrier()
+                .setSrcAccessMask(vk::AccessFlagBits::eAccelerationStructureWriteKHR)
+                .setDstAccessMask(vk::AccessFlagBits::eAccelerationStructureReadKHR);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+            {},
+            barrier,
+            {},
+            {});
+        commandBuffer.writeAccelerationStructuresPropertiesKHR(
+            sourceStructures,
+            vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+            queryPool,
+            0,
+            device->GetDispatcher());
+        VKRT_ASSERT_VK(commandBuffer.end());
+        device->SubmitCommandAndFlush(commandBuffer);
+        device->DestroyCommand(commandBuffer);
+    }
+
+    const std::vector<vk::DeviceSize> compactedSizes =
+        VKRT_ASSERT_VK(logicalDevice.getQueryPoolResults<vk::DeviceSize>(
+            queryPool,
+            0,
+            queryCount,
+            queryCount * sizeof(vk::DeviceSize),
+            sizeof(vk::DeviceSize),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait));
+    logicalDevice.destroyQueryPool(queryPool);
+
+    std::vector<vk::AccelerationStructureKHR> compactedStructures;
+    std::vector<ScopedRefPtr<VulkanBuffer>> compactedBuffers;
+    compactedStructures.reserve(meshes.size());
+    compactedBuffers.reserve(meshes.size());
+
+    vk::CommandBuffer commandBuffer = device->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        ScopedRefPtr<VulkanBuffer> compactedBuffer = device->CreateBuffer(
+            compactedSizes[meshIndex],
+            vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
+                vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            vk::MemoryAllocateFlagBits::eDeviceAddress);
+
+        vk::AccelerationStructureCreateInfoKHR accelerationStructureCreateInfo =
+            vk::AccelerationStructureCreateInfoKHR()
+                .setBuffer(compactedBuffer->GetBufferHandle())
+                .setSize(compactedSizes[meshIndex])
+                .setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+        vk::AccelerationStructureKHR compactedStructure =
+            VKRT_ASSERT_VK(logicalDevice.createAccelerationStructureKHR(
+                accelerationStructureCreateInfo,
+                nullptr,
+                device->GetDispatcher()));
+
+        commandBuffer.copyAccelerationStructureKHR(
+            vk::CopyAccelerationStructureInfoKHR()
+                .setSrc(sourceStructures[meshIndex])
+                .setDst(compactedStructure)
+                .setMode(vk::CopyAccelerationStructureModeKHR::eCompact),
+            device->GetDispatcher());
+
+        compactedStructures.push_back(compactedStructure);
+        compactedBuffers.push_back(compactedBuffer);
+    }
+    VKRT_ASSERT_VK(commandBuffer.end());
+    device->SubmitCommandAndFlush(commandBuffer);
+    device->DestroyCommand(commandBuffer);
+
+    // Swapping releases the original, uncompacted storage
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        meshes[meshIndex]->SetCompactedBLAS(
+            compactedStructures[meshIndex],
+            compactedBuffers[meshIndex]);
+    }
+}
+
+BLASBuilder::~BLASBuilder() {}
+
+}  // namespace VKRT
@@ -0,0 +1,112 @@
+#include "BindlessTextureTable.h"
+
+#include <algorithm>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Texture.h"
+
+namespace VKRT {
+
+BindlessTextureTable::BindlessTextureTable(ScopedRefPtr<Context> context)
+    : mContext(context), mTextures(), mFreeSlots(), mRetiredSlots(), mFrameNumber(0) {
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::Device& logicalDevice = device->GetLogicalDevice();
+
+    // Leave room for the few sampled images other sets in the pipeline use
+    const vk::PhysicalDeviceDescriptorIndexingProperties indexingProperties =
+        device->GetDescriptorIndexingProperties();
+    constexpr uint32_t ReservedSlots = 16;
+    mCapacity = std::min(
+        {MaxCapacity,
+         indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages - ReservedSlots,
+         indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages - ReservedSlots});
+
+    const vk::DescriptorSetLayoutBinding binding =
+        vk::DescriptorSetLayoutBinding()
+            .setBinding(0)
+            .setDescriptorType(vk::DescriptorType::eSampledImage)
+            .setDescriptorCount(mCapacity)
+            .setStageFlags(vk::ShaderStageFlagBits::eClosestHitKHR);
+    const vk::DescriptorBindingFlags bindingFlags =
+        vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+        vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending |
+        vk::DescriptorBindingFlagBits::ePartiallyBound;
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo layoutFlagsCreateInfo =
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo().setBindingFlags(bindingFlags);
+    mDescriptorLayout = VKRT_ASSERT_VK(logicalDevice.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo()
+            .setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+            .setBindings(binding)
+            .setPNext(&layoutFlagsCreateInfo)));
+
+    const vk::DescriptorPoolSize poolSize(vk::DescriptorType::eSampledImage, mCapacity);
+    mDescriptorPool = VKRT_ASSERT_VK(logicalDevice.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo()
+            .setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+            .setPoolSizes(poolSize)
+            .setMaxSets(1)));
+    mDescriptorSet = VKRT_ASSERT_VK(logicalDevice.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo()
+            .setDescriptorPool(mDescriptorPool)
+            .setSetLayouts(mDescriptorLayout)))[0];
+
+    mTextures.resize(mCapacity);
+    mFreeSlots.reserve(mCapacity);
+    for (uint32_t slot = mCapacity; slot > 0; --slot) {
+        mFreeSlots.push_back(slot - 1);
+    }
+}
+
+uint32_t BindlessTextureTable::Add(ScopedRefPtr<Texture> texture) {
+    VKRT_ASSERT_MSG(!mFreeSlots.empty(), "Bindless texture table is full");
+    const uint32_t slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    mTextures[slot] = texture;
+
+    // The slot is not referenced by any pending work, so it can be written while the set is bound
+    const vk::DescriptorImageInfo imageInfo =
+        vk::DescriptorImageInfo()
+            .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setImageView(texture->GetImageView());
+    mContext->GetDevice()->GetLogicalDevice().updateDescriptorSets(
+        vk::WriteDescriptorSet()
+            .setDstSet(mDescriptorSet)
+            .setDstBinding(0)
+            .setDstArrayElement(slot)
+            .setDescriptorType(vk::DescriptorType::eSampledImage)
+            .setImageInfo(imageInfo),
+        {});
+    return slot;
+}
+
+void BindlessTextureTable::Remove(uint32_t slot) {
+    VKRT_ASSERT(slot < mCapacity && mTextures[slot] != nullptr);
+    mRetiredSlots.push_back(RetiredSlot{.slot = slot, .frame = mFrameNumber});
+}
+
+void BindlessTextureTable::BeginFrame(uint32_t framesInFlight) {
+    ++mFrameNumber;
+
+    // A slot removed while recording frame F may still be sampled by frames up to F - 1, those
+    // are all done once framesInFlight more frames have started
+    auto retired = std::partition(
+        mRetiredSlots.begin(),
+        mRetiredSlots.end(),
+        [this, framesInFlight](const RetiredSlot& retiredSlot) {
+            return retiredSlot.frame + framesInFlight > mFrameNumber;
+        });
+    for (auto it = retired; it != mRetiredSlots.end(); ++it) {
+        mTextures[it->slot] = nullptr;
+        mFreeSlots.push_back(it->slot);
+    }
+    mRetiredSlots.erase(retired, mRetiredSlots.end());
+}
+
+BindlessTextureTable::~BindlessTextureTable() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroyDescriptorPool(mDescriptorPool);
+    logicalDevice.destroyDescriptorSetLayout(mDescriptorLayout);
+}
+
+}  // namespace VKRT
@@ -0,0 +1,141 @@
+#include "ComputePipeline.h"
+
+#include <unordered_map>
+
+#include "Context.h"
+#include "DebugUtils.h"
+
+namespace VKRT {
+
+ComputePipeline::ComputePipeline(
+    ScopedRefPtr<Context> context,
+    const std::vector<Pipeline::Descriptor>& descriptors,
+    Resource::Id shaderId,
+    uint32_t pushConstantSize)
+    : mContext(context), mPushConstantSize(pushConstantSize) {
+    std::vector<vk::DescriptorSetLayoutBinding> descriptorBindings;
+    std::unordered_map<vk::DescriptorType, uint32_t> descriptorSizes;
+    uint32_t descriptorBinding = 0;
+    for (const Pipeline::Descriptor& descriptor : descriptors) {
+        descriptorBindings.emplace_back(vk::DescriptorSetLayoutBinding()
+                                            .setBinding(descriptorBinding)
+                                            .setDescriptorType(descriptor.type)
+                                            .setDescriptorCount(descriptor.count)
+                                            .setStageFlags(vk::ShaderStageFlagBits::eCompute));
+        descriptorSizes[descriptor.type] += descriptor.count;
+        mDescriptorTypes.push_back(descriptor.type);
+        ++descriptorBinding;
+    }
+    for (auto descriptorSize : descriptorSizes) {
+        mDescriptorSizes.emplace_back(descriptorSize.first, descriptorSize.second);
+    }
+
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    mDescriptorLayout = VKRT_ASSERT_VK(logicalDevice.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo().setBindings(descriptorBindings)));
+
+    const vk::PushConstantRange pushConstantRange =
+        vk::PushConstantRange()
+            .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+            .setOffset(0)
+            .setSize(mPushConstantSize);
+    vk::PipelineLayoutCreateInfo layoutCreateInfo =
+        vk::PipelineLayoutCreateInfo().setSetLayouts(mDescriptorLayout);
+    if (mPushConstantSize > 0) {
+        layoutCreateInfo.setPushConstantRanges(pushConstantRange);
+    }
+    mLayout = VKRT_ASSERT_VK(logicalDevice.createPipelineLayout(layoutCreateInfo));
+
+    Resource shaderResource = ResourceLoader::Load(shaderId);
+    vk::ShaderModuleCreateInfo shaderCreateInfo =
+        vk::ShaderModuleCreateInfo()
+            .setCodeSize(shaderResource.size * sizeof(uint8_t))
+            .setPCode(reinterpret_cast<const uint32_t*>(shaderResource.buffer));
+    mShader = VKRT_ASSERT_VK(logicalDevice.createShaderModule(shaderCreateInfo));
+    ResourceLoader::CleanUp(shaderResource);
+
+    vk::ComputePipelineCreateInfo pipelineCreateInfo =
+        vk::ComputePipelineCreateInfo()
+            .setStage(vk::PipelineShaderStageCreateInfo()
+                          .setPName("main")
+                          .setModule(mShader)
+                          .setStage(vk::ShaderStageFlagBits::eCompute))
+            .setLayout(mLayout);
+    mPipeline = VKRT_ASSERT_VK(logicalDevice.createComputePipeline({}, pipelineCreateInfo));
+}
+
+vk::DescriptorSet ComputePipeline::CreateDescriptorSet(const std::vector<Binding>& bindings) {
+    VKRT_ASSERT(bindings.size() == mDescriptorTypes.size());
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    const vk::DescriptorPool descriptorPool =
+        VKRT_ASSERT_VK(logicalDevice.createDescriptorPool(
+            vk::DescriptorPoolCreateInfo().setPoolSizes(mDescriptorSizes).setMaxSets(1)));
+    mDescriptorPools.push_back(descriptorPool);
+    const vk::DescriptorSet descriptorSet =
+        VKRT_ASSERT_VK(logicalDevice.allocateDescriptorSets(
+            vk::DescriptorSetAllocateInfo()
+                .setDescriptorPool(descriptorPool)
+                .setSetLayouts(mDescriptorLayout)))[0];
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (uint32_t binding = 0; binding < bindings.size(); ++binding) {
+        const vk::DescriptorType type = mDescriptorTypes[binding];
+        vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
+                                           .setDstSet(descriptorSet)
+                                           .setDstBinding(binding)
+                                           .setDescriptorCount(1)
+                                           .setDescriptorType(type);
+        const bool isImage = type == vk::DescriptorType::eStorageImage ||
+                             type == vk::DescriptorType::eSampledImage ||
+                             type == vk::DescriptorType::eCombinedImageSampler;
+        if (isImage) {
+            write.setImageInfo(bindings[binding].image);
+        } else {
+            write.setBufferInfo(bindings[binding].buffer);
+        }
+        writeDescriptorSets.push_back(write);
+    }
+    logicalDevice.updateDescriptorSets(writeDescriptorSets, {});
+    return descriptorSet;
+}
+
+void ComputePipeline::Dispatch(
+    vk::CommandBuffer& commandBuffer,
+    vk::DescriptorSet descriptorSet,
+    uint32_t width,
+    uint32_t height,
+    const void* pushConstants) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, mPipeline);
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute,
+        mLayout,
+        0,
+        descriptorSet,
+        {});
+    if (pushConstants != nullptr) {
+        VKRT_ASSERT(mPushConstantSize > 0);
+        commandBuffer.pushConstants(
+            mLayout,
+            vk::ShaderStageFlagBits::eCompute,
+            0,
+            mPushConstantSize,
+            pushConstants);
+    }
+    commandBuffer.dispatch(
+        (width + WorkgroupSize - 1) / WorkgroupSize,
+        (height + WorkgroupSize - 1) / WorkgroupSize,
+        1);
+}
+
+ComputePipeline::~ComputePipeline() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    for (const vk::DescriptorPool& descriptorPool : mDescriptorPools) {
+        logicalDevice.destroyDescriptorPool(descriptorPool);
+    }
+    logicalDevice.destroyShaderModule(mShader);
+    logicalDevice.destroyDescriptorSetLayout(mDescriptorLayout);
+    logicalDevice.destroyPipeline(mPipeline);
+    logicalDevice.destroyPipelineLayout(mLayout);
+}
+
+}  // namespace VKRT
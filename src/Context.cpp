@@ -17,10 +17,14 @@ Context::Context(
     mDevice = device;
     mDevice->SetContext(this);
     mSwapchain = new Swapchain(this);
+    mUploadManager = new UploadManager(this);
+    mBLASBuilder = new BLASBuilder(this);
 }
 
 void Context::Destroy() {
     VKRT_ASSERT_VK(mDevice->GetLogicalDevice().waitIdle());
+    mBLASBuilder = nullptr;
+    mUploadManager = nullptr;
     mSwapchain = nullptr;
     mInstance->DestroySurface(mSurface);
     mDevice = nullptr;
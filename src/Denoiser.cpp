@@ -0,0 +1,162 @@
+#include "Denoiser.h"
+
+#include <array>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Texture.h"
+
+#undef MemoryBarrier
+
+namespace VKRT {
+
+Denoiser::Denoiser(
+    ScopedRefPtr<Context> context,
+    const std::array<ScopedRefPtr<Texture>, HistoryCount>& radianceTextures)
+    : mContext(context),
+      mWidth(radianceTextures[0]->GetWidth()),
+      mHeight(radianceTextures[0]->GetHeight()),
+      mRadianceTextures(radianceTextures) {
+    // Cleared so the first frames don't blend with garbage history, in a single submission
+    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    auto createImage = [&](vk::Format format) {
+        return Texture::CreateStorageImage(mContext, commandBuffer, mWidth, mHeight, format);
+    };
+    mAlbedoTexture = createImage(vk::Format::eR8G8B8A8Unorm);
+    for (uint32_t historyIndex = 0; historyIndex < HistoryCount; ++historyIndex) {
+        mNormalDepthTextures[historyIndex] = createImage(vk::Format::eR32G32B32A32Sfloat);
+        mMomentsTextures[historyIndex] = createImage(vk::Format::eR32G32Sfloat);
+    }
+    mPingTexture = createImage(vk::Format::eR32G32B32A32Sfloat);
+    mPongTexture = createImage(vk::Format::eR32G32B32A32Sfloat);
+    mOutputTexture = createImage(vk::Format::eR32G32B32A32Sfloat);
+    VKRT_ASSERT_VK(commandBuffer.end());
+    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
+    mContext->GetDevice()->DestroyCommand(commandBuffer);
+
+    const Pipeline::Descriptor storageImage{
+        .type = vk::DescriptorType::eStorageImage,
+        .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    mVariancePipeline = new ComputePipeline(
+        mContext,
+        std::vector<Pipeline::Descriptor>(5, storageImage),
+        Resource::Id::DenoiseVarianceShader);
+    mAtrousPipeline = new ComputePipeline(
+        mContext,
+        std::vector<Pipeline::Descriptor>(4, storageImage),
+        Resource::Id::DenoiseAtrousShader,
+        sizeof(AtrousConstants));
+
+    CreateDescriptors();
+}
+
+void Denoiser::CreateDescriptors() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+
+    constexpr uint32_t AtrousSetCount = 3;
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+    for (vk::DescriptorPoolSize poolSize : mVariancePipeline->GetDescriptorSizes()) {
+        poolSize.descriptorCount *= HistoryCount;
+        poolSizes.push_back(poolSize);
+    }
+    for (vk::DescriptorPoolSize poolSize : mAtrousPipeline->GetDescriptorSizes()) {
+        poolSize.descriptorCount *= AtrousSetCount * HistoryCount;
+        poolSizes.push_back(poolSize);
+    }
+    mDescriptorPool = VKRT_ASSERT_VK(logicalDevice.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo().setPoolSizes(poolSizes).setMaxSets(
+            (1 + AtrousSetCount) * HistoryCount)));
+
+    // Image infos have to outlive the update call
+    std::vector<vk::DescriptorImageInfo> imageInfos;
+    imageInfos.reserve((5 + 4 * AtrousSetCount) * HistoryCount);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    auto writeImages = [&](vk::DescriptorSet set, const std::vector<Texture*>& textures) {
+        for (uint32_t binding = 0; binding < textures.size(); ++binding) {
+            imageInfos.push_back(vk::DescriptorImageInfo()
+                                     .setImageView(textures[binding]->GetImageView())
+                                     .setImageLayout(vk::ImageLayout::eGeneral));
+            writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                              .setDstSet(set)
+                                              .setDstBinding(binding)
+                                              .setDescriptorCount(1)
+                                              .setDescriptorType(vk::DescriptorType::eStorageImage)
+                                              .setImageInfo(imageInfos.back()));
+        }
+    };
+
+    const std::vector<vk::DescriptorSetLayout> setLayouts{
+        mVariancePipeline->GetDescriptorLayout(),
+        mAtrousPipeline->GetDescriptorLayout(),
+        mAtrousPipeline->GetDescriptorLayout(),
+        mAtrousPipeline->GetDescriptorLayout()};
+    for (uint32_t historyIndex = 0; historyIndex < HistoryCount; ++historyIndex) {
+        std::vector<vk::DescriptorSet> descriptorSets =
+            VKRT_ASSERT_VK(logicalDevice.allocateDescriptorSets(
+                vk::DescriptorSetAllocateInfo()
+                    .setDescriptorPool(mDescriptorPool)
+                    .setSetLayouts(setLayouts)));
+        PassSets& passSets = mPassSets[historyIndex];
+        passSets.variance = descriptorSets[0];
+        passSets.pingToPong = descriptorSets[1];
+        passSets.pongToPing = descriptorSets[2];
+        passSets.pingToOutput = descriptorSets[3];
+
+        Texture* normalDepth = mNormalDepthTextures[historyIndex];
+        writeImages(
+            passSets.variance,
+            {mRadianceTextures[historyIndex],
+             mAlbedoTexture,
+             normalDepth,
+             mMomentsTextures[historyIndex],
+             mPingTexture});
+        writeImages(passSets.pingToPong, {mPingTexture, mAlbedoTexture, normalDepth, mPongTexture});
+        writeImages(passSets.pongToPing, {mPongTexture, mAlbedoTexture, normalDepth, mPingTexture});
+        writeImages(
+            passSets.pingToOutput,
+            {mPingTexture, mAlbedoTexture, normalDepth, mOutputTexture});
+    }
+    logicalDevice.updateDescriptorSets(writeDescriptorSets, {});
+}
+
+void Denoiser::Denoise(vk::CommandBuffer& commandBuffer, uint32_t historyIndex) {
+    // Every pass reads what the previous one wrote
+    const vk::MemoryBarrier passBarrier = vk::MemoryBarrier()
+                                              .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                              .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    auto waitForPreviousPass = [&]() {
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            passBarrier,
+            {},
+            {});
+    };
+
+    const PassSets& passSets = mPassSets[historyIndex];
+    mVariancePipeline->Dispatch(commandBuffer, passSets.variance, mWidth, mHeight);
+
+    // Odd so the last iteration reads from the ping image
+    static_assert(AtrousIterations % 2 == 1);
+    for (uint32_t iteration = 0; iteration < AtrousIterations; ++iteration) {
+        waitForPreviousPass();
+        const bool isLast = iteration + 1 == AtrousIterations;
+        const AtrousConstants constants{
+            .stepSize = 1 << iteration,
+            .modulate = isLast ? 1u : 0u};
+        vk::DescriptorSet descriptorSet = isLast               ? passSets.pingToOutput
+                                          : iteration % 2 == 0 ? passSets.pingToPong
+                                                               : passSets.pongToPing;
+        mAtrousPipeline->Dispatch(commandBuffer, descriptorSet, mWidth, mHeight, &constants);
+    }
+    waitForPreviousPass();
+}
+
+Denoiser::~Denoiser() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroyDescriptorPool(mDescriptorPool);
+}
+
+}  // namespace VKRT
@@ -1,6 +1,8 @@
 #include "Device.h"
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <limits>
 
 #include "DebugUtils.h"
@@ -38,13 +40,37 @@ Device::Device(
         ++queueFamilyIndex;
     }
     VKRT_ASSERT(queueFamilyIndex < static_cast<uint32_t>(queueFamiliesProperties.size()));
+    mGraphicsQueueFamilyIndex = queueFamilyIndex;
+
+    // A family that can only transfer usually maps to the copy engines, uploads run there
+    // without competing with ray tracing work
+    mTransferQueueFamilyIndex = mGraphicsQueueFamilyIndex;
+    for (uint32_t familyIndex = 0; familyIndex < queueFamiliesProperties.size(); ++familyIndex) {
+        const vk::QueueFlags flags = queueFamiliesProperties[familyIndex].queueFlags;
+        if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & vk::QueueFlagBits::eGraphics) &&
+            !(flags & vk::QueueFlagBits::eCompute)) {
+            mTransferQueueFamilyIndex = familyIndex;
+            break;
+        }
+    }
+
     const std::vector<float> queuePriorities{1.0f};
-    vk::DeviceQueueCreateInfo queueCreateInfo = vk::DeviceQueueCreateInfo()
-                                                    .setQueueFamilyIndex(queueFamilyIndex)
-                                                    .setQueuePriorities(queuePriorities);
+    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos{
+        vk::DeviceQueueCreateInfo()
+            .setQueueFamilyIndex(mGraphicsQueueFamilyIndex)
+            .setQueuePriorities(queuePriorities)};
+    if (HasDedicatedTransferQueue()) {
+        queueCreateInfos.push_back(vk::DeviceQueueCreateInfo()
+                                       .setQueueFamilyIndex(mTransferQueueFamilyIndex)
+                                       .setQueuePriorities(queuePriorities));
+    }
 
     vk::PhysicalDeviceFeatures enabledFeatures =
-        vk::PhysicalDeviceFeatures().setShaderInt64(true).setSamplerAnisotropy(true);
+        vk::PhysicalDeviceFeatures()
+            .setShaderInt64(true)
+            .setSamplerAnisotropy(true)
+            .setShaderStorageImageWriteWithoutFormat(true)
+            .setShaderStorageImageExtendedFormats(true);
 
     vk::PhysicalDeviceRayTracingPipelineFeaturesKHR rayTracingFeatures =
         vk::PhysicalDeviceRayTracingPipelineFeaturesKHR().setRayTracingPipeline(true);
@@ -61,21 +87,27 @@ Device::Device(
             .setDescriptorIndexing(true)
             .setRuntimeDescriptorArray(true)
             .setDescriptorBindingVariableDescriptorCount(true)
+            .setDescriptorBindingPartiallyBound(true)
+            .setDescriptorBindingSampledImageUpdateAfterBind(true)
+            .setDescriptorBindingUpdateUnusedWhilePending(true)
+            .setShaderSampledImageArrayNonUniformIndexing(true)
+            .setTimelineSemaphore(true)
             .setPNext(&accelerationStructureFeatures);
 
     const vk::DeviceCreateInfo deviceCreateInfo =
         vk::DeviceCreateInfo()
-            .setQueueCreateInfos(queueCreateInfo)
+            .setQueueCreateInfos(queueCreateInfos)
             .setPEnabledExtensionNames(Instance::sRequiredDeviceExtensions)
             .setPEnabledFeatures(&enabledFeatures)
             .setPNext(&enabledFeatures12);
     mLogicalDevice = VKRT_ASSERT_VK(mPhysicalDevice.createDevice(deviceCreateInfo));
 
-    mGraphicsQueue = mLogicalDevice.getQueue(queueFamilyIndex, 0);
+    mGraphicsQueue = mLogicalDevice.getQueue(mGraphicsQueueFamilyIndex, 0);
+    mTransferQueue = mLogicalDevice.getQueue(mTransferQueueFamilyIndex, 0);
 
     const vk::CommandPoolCreateInfo commandPoolCreateInfo =
         vk::CommandPoolCreateInfo()
-            .setQueueFamilyIndex(queueFamilyIndex)
+            .setQueueFamilyIndex(mGraphicsQueueFamilyIndex)
             .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
     mCommandPool = VKRT_ASSERT_VK(mLogicalDevice.createCommandPool(commandPoolCreateInfo));
 
@@ -84,47 +116,119 @@ Device::Device(
         vkGetInstanceProcAddr,
         mLogicalDevice,
         vkGetDeviceProcAddr);
+
+    mMemoryAllocator = std::make_unique<MemoryAllocator>(mPhysicalDevice, mLogicalDevice);
 }
 
 void Device::SetContext(ScopedRefPtr<Context> context) {
     mContext = context;
 }
 
-vk::DeviceMemory Device::AllocateMemory(
-    const vk::MemoryPropertyFlags& memoryFlags,
-    const vk::MemoryRequirements memoryRequirements,
-    const vk::MemoryAllocateFlags& memoryAllocateFlags) {
-    // Find suitable memory to allocate the buffer in
+uint32_t Device::FindMemoryType(
+    const vk::MemoryPropertyFlags& requiredFlags,
+    const vk::MemoryPropertyFlags& preferredFlags,
+    const vk::MemoryRequirements& memoryRequirements) {
+    // Every required flag must be present. Among those types, preferred flags score up and any
+    // other property scores down, so e.g. staging memory stays out of the small host visible
+    // device local heap and device only resources never land in host visible memory
     const vk::PhysicalDeviceMemoryProperties memoryProperties =
         mPhysicalDevice.getMemoryProperties();
-    uint32_t selectedMemoryIndex = 0;
+    constexpr vk::MemoryPropertyFlags scoredFlags =
+        vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible |
+        vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostCached;
+    auto countFlags = [](vk::MemoryPropertyFlags flags) {
+        return std::popcount(static_cast<VkMemoryPropertyFlags>(flags));
+    };
+
+    uint32_t selectedMemoryIndex = std::numeric_limits<uint32_t>::max();
+    int selectedScore = std::numeric_limits<int>::min();
     for (uint32_t memoryIndex = 0; memoryIndex < memoryProperties.memoryTypeCount; ++memoryIndex) {
-        if (memoryRequirements.memoryTypeBits & (1 << memoryIndex) &&
-            (memoryProperties.memoryTypes[memoryIndex].propertyFlags & memoryFlags)) {
+        const vk::MemoryPropertyFlags typeFlags =
+            memoryProperties.memoryTypes[memoryIndex].propertyFlags;
+        if (!(memoryRequirements.memoryTypeBits & (1 << memoryIndex)) ||
+            (typeFlags & requiredFlags) != requiredFlags ||
+            (typeFlags & vk::MemoryPropertyFlagBits::eProtected)) {
+            continue;
+        }
+        const vk::MemoryPropertyFlags extraFlags = typeFlags & scoredFlags & ~requiredFlags;
+        const int score =
+            countFlags(extraFlags & preferredFlags) - countFlags(extraFlags & ~preferredFlags);
+        if (score > selectedScore) {
+            selectedScore = score;
             selectedMemoryIndex = memoryIndex;
-            break;
         }
     }
+    VKRT_ASSERT_MSG(
+        selectedMemoryIndex != std::numeric_limits<uint32_t>::max(),
+        "No memory type satisfies the required property flags");
+    return selectedMemoryIndex;
+}
 
-    // Allocate memory for the buffer
-    vk::MemoryAllocateFlagsInfo memoryAllocateFlagsInfo =
-        vk::MemoryAllocateFlagsInfo().setFlags(memoryAllocateFlags);
-    vk::MemoryAllocateInfo allocateInfo = vk::MemoryAllocateInfo()
-                                              .setAllocationSize(memoryRequirements.size)
-                                              .setMemoryTypeIndex(selectedMemoryIndex);
-    if (memoryAllocateFlags != vk::MemoryAllocateFlags()) {
-        allocateInfo.setPNext(&memoryAllocateFlagsInfo);
-    }
-    return VKRT_ASSERT_VK(mLogicalDevice.allocateMemory(allocateInfo));
+MemoryAllocation Device::AllocateBufferMemory(
+    const vk::Buffer& buffer,
+    const vk::MemoryPropertyFlags& memoryFlags,
+    const vk::MemoryAllocateFlags& memoryAllocateFlags,
+    const vk::MemoryPropertyFlags& preferredMemoryFlags,
+    vk::DeviceSize minAlignment) {
+    const auto memoryRequirements = mLogicalDevice.getBufferMemoryRequirements2<
+        vk::MemoryRequirements2,
+        vk::MemoryDedicatedRequirements>(vk::BufferMemoryRequirementsInfo2().setBuffer(buffer));
+    vk::MemoryRequirements requirements =
+        memoryRequirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    // Both are powers of two, so the larger one satisfies the other
+    requirements.alignment = std::max(requirements.alignment, minAlignment);
+    const vk::MemoryDedicatedRequirements& dedicatedRequirements =
+        memoryRequirements.get<vk::MemoryDedicatedRequirements>();
+    return mMemoryAllocator->Allocate(MemoryAllocator::Request{
+        .requirements = requirements,
+        .memoryTypeIndex = FindMemoryType(memoryFlags, preferredMemoryFlags, requirements),
+        .kind = MemoryResourceKind::Linear,
+        .dedicated = static_cast<bool>(dedicatedRequirements.prefersDedicatedAllocation),
+        .allocateFlags = memoryAllocateFlags,
+        .dedicatedBuffer = buffer,
+        .dedicatedImage = nullptr,
+    });
+}
+
+MemoryAllocation Device::AllocateImageMemory(
+    const vk::Image& image,
+    const vk::MemoryPropertyFlags& memoryFlags) {
+    const auto memoryRequirements = mLogicalDevice.getImageMemoryRequirements2<
+        vk::MemoryRequirements2,
+        vk::MemoryDedicatedRequirements>(vk::ImageMemoryRequirementsInfo2().setImage(image));
+    const vk::MemoryRequirements& requirements =
+        memoryRequirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    const vk::MemoryDedicatedRequirements& dedicatedRequirements =
+        memoryRequirements.get<vk::MemoryDedicatedRequirements>();
+    return mMemoryAllocator->Allocate(MemoryAllocator::Request{
+        .requirements = requirements,
+        .memoryTypeIndex = FindMemoryType(memoryFlags, {}, requirements),
+        .kind = MemoryResourceKind::Optimal,
+        .dedicated = static_cast<bool>(dedicatedRequirements.prefersDedicatedAllocation),
+        .allocateFlags = {},
+        .dedicatedBuffer = nullptr,
+        .dedicatedImage = image,
+    });
+}
+
+void Device::FreeMemory(const MemoryAllocation& allocation) {
+    mMemoryAllocator->Free(allocation);
 }
 
 ScopedRefPtr<VulkanBuffer> Device::CreateBuffer(
     const vk::DeviceSize& size,
     const vk::BufferUsageFlags& usageFlags,
     const vk::MemoryPropertyFlags& memoryFlags,
-    const vk::MemoryAllocateFlags& memoryAllocateFlags) {
+    const vk::MemoryAllocateFlags& memoryAllocateFlags,
+    const vk::MemoryPropertyFlags& preferredMemoryFlags) {
     VKRT_ASSERT(mContext != nullptr);
-    return VulkanBuffer::Create(mContext, size, usageFlags, memoryFlags, memoryAllocateFlags);
+    return VulkanBuffer::Create(
+        mContext,
+        size,
+        usageFlags,
+        memoryFlags,
+        memoryAllocateFlags,
+        preferredMemoryFlags);
 }
 
 vk::CommandBuffer Device::CreateCommandBuffer() {
@@ -151,8 +255,9 @@ void Device::DestroyCommand(vk::CommandBuffer& commandBuffer) {
     mLogicalDevice.freeCommandBuffers(mCommandPool, commandBuffer);
 }
 
-vk::Fence Device::CreateFence() {
-    const vk::FenceCreateInfo fenceInfo = vk::FenceCreateInfo();
+vk::Fence Device::CreateFence(bool signaled) {
+    const vk::FenceCreateInfo fenceInfo = vk::FenceCreateInfo().setFlags(
+        signaled ? vk::FenceCreateFlagBits::eSignaled : vk::FenceCreateFlags{});
     return VKRT_ASSERT_VK(mLogicalDevice.createFence(fenceInfo));
 }
 
@@ -178,6 +283,10 @@ vk::PhysicalDeviceProperties Device::GetDeviceProperties() {
     return mPhysicalDevice.getProperties();
 }
 
+vk::FormatProperties Device::GetFormatProperties(vk::Format format) {
+    return mPhysicalDevice.getFormatProperties(format);
+}
+
 vk::PhysicalDeviceRayTracingPipelinePropertiesKHR Device::GetRayTracingProperties() {
     auto result = mPhysicalDevice.getProperties2<
         vk::PhysicalDeviceProperties2,
@@ -185,7 +294,22 @@ vk::PhysicalDeviceRayTracingPipelinePropertiesKHR Device::GetRayTracingPropertie
     return result.get<vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
 }
 
+vk::PhysicalDeviceAccelerationStructurePropertiesKHR Device::GetAccelerationStructureProperties() {
+    auto result = mPhysicalDevice.getProperties2<
+        vk::PhysicalDeviceProperties2,
+        vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+    return result.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+}
+
+vk::PhysicalDeviceDescriptorIndexingProperties Device::GetDescriptorIndexingProperties() {
+    auto result = mPhysicalDevice.getProperties2<
+        vk::PhysicalDeviceProperties2,
+        vk::PhysicalDeviceDescriptorIndexingProperties>();
+    return result.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+}
+
 Device::~Device() {
+    mMemoryAllocator.reset();
     mLogicalDevice.destroyCommandPool(mCommandPool);
     mLogicalDevice.destroy();
 }
@@ -0,0 +1,66 @@
+#include "DynamicBufferRing.h"
+
+#include <algorithm>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "VulkanBuffer.h"
+
+namespace VKRT {
+
+namespace {
+vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+DynamicBufferRing::DynamicBufferRing(
+    ScopedRefPtr<Context> context,
+    vk::DeviceSize frameCapacity,
+    uint32_t frameCount,
+    const vk::BufferUsageFlags& usageFlags)
+    : mContext(context), mFrameBegin(0), mFrameHead(0) {
+    const vk::PhysicalDeviceLimits limits = mContext->GetDevice()->GetDeviceProperties().limits;
+    mAlignment = std::max(
+        limits.minUniformBufferOffsetAlignment,
+        limits.minStorageBufferOffsetAlignment);
+    mFrameCapacity = AlignUp(frameCapacity, mAlignment);
+
+    // Device local is preferred when the host can see it (resizable BAR), shader reads then stay
+    // on the device
+    mBuffer = mContext->GetDevice()->CreateBuffer(
+        mFrameCapacity * frameCount,
+        usageFlags,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        {},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    mMappedData = mBuffer->MapBuffer();
+}
+
+void DynamicBufferRing::BeginFrame(uint32_t frameIndex) {
+    mFrameBegin = mFrameCapacity * frameIndex;
+    mFrameHead = mFrameBegin;
+}
+
+DynamicBufferRing::Allocation DynamicBufferRing::Allocate(vk::DeviceSize size) {
+    const vk::DeviceSize offset = mFrameHead;
+    mFrameHead = AlignUp(mFrameHead + size, mAlignment);
+    VKRT_ASSERT_MSG(
+        mFrameHead <= mFrameBegin + mFrameCapacity,
+        "Dynamic buffer ring frame capacity exceeded");
+    return Allocation{
+        .data = mMappedData + offset,
+        .offset = static_cast<uint32_t>(offset),
+    };
+}
+
+vk::DescriptorBufferInfo DynamicBufferRing::GetDescriptorInfo(vk::DeviceSize range) const {
+    return vk::DescriptorBufferInfo()
+        .setBuffer(mBuffer->GetBufferHandle())
+        .setOffset(0)
+        .setRange(range);
+}
+
+DynamicBufferRing::~DynamicBufferRing() {}
+
+}  // namespace VKRT
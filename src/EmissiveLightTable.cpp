@@ -0,0 +1,95 @@
+#include "EmissiveLightTable.h"
+
+#include <algorithm>
+
+#include "AliasTable.h"
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Object.h"
+#include "UploadManager.h"
+#include "VulkanBuffer.h"
+
+namespace VKRT {
+
+EmissiveLightTable::EmissiveLightTable(ScopedRefPtr<Context> context)
+    : mContext(context),
+      mLightsBuffer(nullptr),
+      mTriangleCount(0),
+      mMaterials(),
+      mMaterialVersions() {}
+
+void EmissiveLightTable::Update(
+    const std::vector<ScopedRefPtr<Object>>& objects,
+    bool geometryChanged) {
+    std::vector<const Material*> materials;
+    std::vector<uint32_t> materialVersions;
+    for (const Object* object : objects) {
+        for (const Mesh* mesh : object->GetModel()->GetMeshes()) {
+            materials.push_back(mesh->GetMaterial().Get());
+            materialVersions.push_back(mesh->GetMaterial()->GetVersion());
+        }
+    }
+    if (mLightsBuffer != nullptr && !geometryChanged && materials == mMaterials &&
+        materialVersions == mMaterialVersions) {
+        return;
+    }
+    mMaterials = std::move(materials);
+    mMaterialVersions = std::move(materialVersions);
+
+    std::vector<EmissiveTriangle> triangles;
+    float totalPower = 0.0f;
+    for (const Object* object : objects) {
+        const glm::mat4& transform = object->GetTransform();
+        for (const Mesh* mesh : object->GetModel()->GetMeshes()) {
+            const glm::vec3 emission = mesh->GetMaterial()->GetEmissive();
+            const float luminance = glm::dot(emission, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+            if (luminance <= 0.0f) {
+                continue;
+            }
+
+            const std::vector<glm::vec3>& positions = mesh->GetPositions();
+            for (const glm::uvec3& triangle : mesh->GetIndices()) {
+                const glm::vec3 v0 = glm::vec3(transform * glm::vec4(positions[triangle.x], 1.0f));
+                const glm::vec3 v1 = glm::vec3(transform * glm::vec4(positions[triangle.y], 1.0f));
+                const glm::vec3 v2 = glm::vec3(transform * glm::vec4(positions[triangle.z], 1.0f));
+                const float area = 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+                if (area <= 0.0f) {
+                    continue;
+                }
+                const float power = area * luminance;
+                triangles.push_back(EmissiveTriangle{
+                    .v0 = v0,
+                    .selectionProbability = power,
+                    .v1 = v1,
+                    .aliasProbability = 1.0f,
+                    .v2 = v2,
+                    .alias = static_cast<uint32_t>(triangles.size()),
+                    .emission = emission,
+                    .area = area});
+                totalPower += power;
+            }
+        }
+    }
+    BuildAliasTable(triangles, totalPower);
+
+    // The shader binding can't be empty, an empty table is just the header
+    const Header header{
+        .triangleCount = static_cast<uint32_t>(triangles.size()),
+        .totalPower = totalPower,
+        .padding = {0, 0}};
+    const vk::DeviceSize trianglesSize = sizeof(EmissiveTriangle) * triangles.size();
+    mLightsBuffer = mContext->GetDevice()->CreateBuffer(
+        sizeof(Header) + trianglesSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->UploadBuffer(mLightsBuffer, &header, sizeof(Header));
+    if (!triangles.empty()) {
+        uploadManager->UploadBuffer(mLightsBuffer, triangles.data(), trianglesSize, sizeof(Header));
+    }
+    mTriangleCount = header.triangleCount;
+}
+
+EmissiveLightTable::~EmissiveLightTable() {}
+
+}  // namespace VKRT
@@ -0,0 +1,220 @@
+#include "Environment.h"
+
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// tiny_gltf already compiles the implementation in Model.cpp
+#undef STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "AliasTable.h"
+#include "ComputePipeline.h"
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Texture.h"
+#include "UploadManager.h"
+#include "VulkanBuffer.h"
+
+#undef MemoryBarrier
+
+namespace VKRT {
+
+Environment::Environment(ScopedRefPtr<Context> context)
+    : mContext(context),
+      mType(Type::ProceduralSky),
+      mWidth(0),
+      mHeight(0),
+      mTexels(),
+      mIntensity(1.0f),
+      mDirectionToSun(glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f))),
+      mVersion(0),
+      mUploadedVersion(0),
+      mBuffer(nullptr),
+      mSkyBaked(false),
+      mBakedDirectionToSun(0.0f) {
+    CreateSkyTexture(SkySize);
+    CreateSkyBakePipeline();
+}
+
+Environment::Environment(
+    ScopedRefPtr<Context> context,
+    uint32_t width,
+    uint32_t height,
+    std::vector<Texel>&& texels)
+    : mContext(context),
+      mType(Type::Map),
+      mWidth(width),
+      mHeight(height),
+      mTexels(std::move(texels)),
+      mIntensity(1.0f),
+      mDirectionToSun(glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f))),
+      mVersion(0),
+      mUploadedVersion(0),
+      mBuffer(nullptr),
+      mSkyBaked(false),
+      mBakedDirectionToSun(0.0f) {
+    // The miss shader declares the sky texture either way
+    CreateSkyTexture(1);
+}
+
+void Environment::CreateSkyTexture(uint32_t size) {
+    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    mSkyTexture = Texture::CreateStorageImage(
+        mContext,
+        commandBuffer,
+        size,
+        size,
+        vk::Format::eR16G16B16A16Sfloat,
+        vk::ImageUsageFlagBits::eSampled);
+    VKRT_ASSERT_VK(commandBuffer.end());
+    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
+    mContext->GetDevice()->DestroyCommand(commandBuffer);
+
+    // Clamped, the octahedral edges fold onto each other and can't wrap
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    vk::SamplerCreateInfo samplerCreateInfo =
+        vk::SamplerCreateInfo()
+            .setMagFilter(vk::Filter::eLinear)
+            .setMinFilter(vk::Filter::eLinear)
+            .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+            .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+            .setCompareOp(vk::CompareOp::eNever)
+            .setMinLod(0.0f)
+            .setMaxLod(0.0f);
+    mSkySampler = VKRT_ASSERT_VK(logicalDevice.createSampler(samplerCreateInfo));
+}
+
+void Environment::CreateSkyBakePipeline() {
+    const std::vector<Pipeline::Descriptor> descriptors{
+        Pipeline::Descriptor{
+            .type = vk::DescriptorType::eStorageImage,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute},
+    };
+    mSkyBakePipeline = new ComputePipeline(
+        mContext,
+        descriptors,
+        Resource::Id::SkyBakeShader,
+        sizeof(SkyBakeConstants));
+    mSkyBakeSet = mSkyBakePipeline->CreateDescriptorSet({
+        {.image = vk::DescriptorImageInfo()
+                      .setImageView(mSkyTexture->GetImageView())
+                      .setImageLayout(vk::ImageLayout::eGeneral)},
+    });
+}
+
+Environment* Environment::Load(ScopedRefPtr<Context> context, const std::string& path) {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    float* pixels = stbi_loadf(path.c_str(), &width, &height, &channels, 3);
+    if (pixels == nullptr) {
+        VKRT_LOG("Couldn't load environment map " << path << ": " << stbi_failure_reason());
+        return nullptr;
+    }
+
+    // Texels near the poles cover less solid angle, weighting by sin(theta) keeps them from being
+    // oversampled
+    std::vector<Texel> texels(static_cast<size_t>(width) * height);
+    // Millions of small weights, float would stop absorbing them long before the last row
+    double totalWeight = 0.0;
+    for (int y = 0; y < height; ++y) {
+        const float theta = (static_cast<float>(y) + 0.5f) / height * glm::pi<float>();
+        const float sinTheta = std::sin(theta);
+        for (int x = 0; x < width; ++x) {
+            const size_t index = static_cast<size_t>(y) * width + x;
+            const glm::vec3 radiance =
+                glm::max(glm::make_vec3(&pixels[index * 3]), glm::vec3(0.0f));
+            const float weight =
+                glm::dot(radiance, glm::vec3(0.2126f, 0.7152f, 0.0722f)) * sinTheta;
+            texels[index] = Texel{.radiance = radiance, .selectionProbability = weight};
+            totalWeight += weight;
+        }
+    }
+    stbi_image_free(pixels);
+
+    if (totalWeight <= 0.0) {
+        // Black map, nothing to importance sample but the shader still needs a valid table
+        for (Texel& texel : texels) {
+            texel.selectionProbability = 1.0f;
+        }
+        totalWeight = static_cast<double>(texels.size());
+    }
+    BuildAliasTable(texels, static_cast<float>(totalWeight));
+    return new Environment(context, width, height, std::move(texels));
+}
+
+void Environment::Update(vk::CommandBuffer& commandBuffer) {
+    if (mType == Type::ProceduralSky &&
+        (!mSkyBaked || mBakedDirectionToSun != mDirectionToSun)) {
+        BakeSky(commandBuffer);
+    }
+
+    if (mBuffer != nullptr && mUploadedVersion == mVersion) {
+        return;
+    }
+    mUploadedVersion = mVersion;
+
+    const Header header{
+        .type = mType,
+        .width = mWidth,
+        .height = mHeight,
+        .intensity = mIntensity,
+        .directionToSun = mDirectionToSun,
+        .padding = 0.0f};
+    const vk::DeviceSize texelsSize = sizeof(Texel) * mTexels.size();
+    mBuffer = mContext->GetDevice()->CreateBuffer(
+        sizeof(Header) + texelsSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->UploadBuffer(mBuffer, &header, sizeof(Header));
+    if (!mTexels.empty()) {
+        uploadManager->UploadBuffer(mBuffer, mTexels.data(), texelsSize, sizeof(Header));
+    }
+}
+
+void Environment::BakeSky(vk::CommandBuffer& commandBuffer) {
+    // Earlier frames may still be sampling the previous bake
+    const vk::MemoryBarrier readBarrier = vk::MemoryBarrier()
+                                              .setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+                                              .setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        readBarrier,
+        {},
+        {});
+
+    // Texels of an octahedral map cover about 4 pi / size^2 steradians each
+    const SkyBakeConstants constants{
+        .directionToSun = mDirectionToSun,
+        .texelAngle = 2.0f * std::sqrt(glm::pi<float>()) / static_cast<float>(SkySize)};
+    mSkyBakePipeline->Dispatch(commandBuffer, mSkyBakeSet, SkySize, SkySize, &constants);
+
+    const vk::MemoryBarrier writeBarrier = vk::MemoryBarrier()
+                                               .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                               .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        {},
+        writeBarrier,
+        {},
+        {});
+
+    mSkyBaked = true;
+    mBakedDirectionToSun = mDirectionToSun;
+}
+
+Environment::~Environment() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroySampler(mSkySampler);
+}
+
+}  // namespace VKRT
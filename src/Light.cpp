@@ -1,13 +1,13 @@
 #include "Light.h"
 
 namespace VKRT {
-Light::Light() : mIntensity(0.0f) {}
+Light::Light() : mVersion(0), mIntensity(0.0f) {}
 
 Light::~Light() {}
 
 DirectionalLight::DirectionalLight() : Light(), mDirection(glm::vec3(0.0f, -1.0f, 0.0f)) {}
 
-Light::Proxy DirectionalLight::GetProxy() {
+Light::Proxy DirectionalLight::GetProxy() const {
     return Light::Proxy{
         .type = Light::Type::Directional,
         .directionOrPosition = mDirection,
@@ -19,7 +19,7 @@ DirectionalLight::~DirectionalLight() {}
 
 PointLight::PointLight() : Light(), mPosition(glm::vec3(0.0f)) {}
 
-Light::Proxy PointLight::GetProxy() {
+Light::Proxy PointLight::GetProxy() const {
     return Light::Proxy{
         .type = Light::Type::Point,
         .directionOrPosition = mPosition,
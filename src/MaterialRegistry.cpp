@@ -0,0 +1,176 @@
+#include "MaterialRegistry.h"
+
+#include <algorithm>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Texture.h"
+#include "UploadManager.h"
+#include "VulkanBuffer.h"
+
+#undef MemoryBarrier
+
+namespace VKRT {
+
+MaterialRegistry::MaterialRegistry(
+    ScopedRefPtr<Context> context,
+    ScopedRefPtr<Texture> fallbackTexture)
+    : mContext(context),
+      mSlots(),
+      mProxies(),
+      mTextureEntries(),
+      mMaterialsBuffer(nullptr),
+      mUploadedSlotCount(0) {
+    mTextureTable = new BindlessTextureTable(context);
+    // Never released, keeps slot 0 valid for the whole lifetime of the table
+    AcquireTexture(fallbackTexture);
+}
+
+int32_t MaterialRegistry::AcquireTexture(const ScopedRefPtr<Texture>& texture) {
+    if (texture == nullptr) {
+        return -1;
+    }
+    auto [it, inserted] =
+        mTextureEntries.try_emplace(texture.Get(), TextureEntry{.tableSlot = 0, .useCount = 0});
+    if (inserted) {
+        it->second.tableSlot = mTextureTable->Add(texture);
+    }
+    ++it->second.useCount;
+    return static_cast<int32_t>(it->second.tableSlot);
+}
+
+void MaterialRegistry::ReleaseTexture(const ScopedRefPtr<Texture>& texture) {
+    if (texture == nullptr) {
+        return;
+    }
+    auto it = mTextureEntries.find(texture.Get());
+    VKRT_ASSERT(it != mTextureEntries.end() && it->second.useCount > 0);
+    if (--it->second.useCount == 0) {
+        mTextureTable->Remove(it->second.tableSlot);
+        mTextureEntries.erase(it);
+    }
+}
+
+void MaterialRegistry::RefreshSlot(uint32_t slotIndex) {
+    Slot& slot = mSlots[slotIndex];
+    const Material* material = slot.material.Get();
+    slot.version = material->GetVersion();
+
+    // Acquire before releasing so a texture the material keeps doesn't bounce through the table
+    ScopedRefPtr<Texture> albedoTexture = material->GetAlbedoTexture();
+    ScopedRefPtr<Texture> roughnessTexture = material->GetRoughnessTexture();
+    mProxies[slotIndex] = MaterialProxy{
+        .albedo = material->GetAlbedo(),
+        .emissive = material->GetEmissive(),
+        .roughness = material->GetRoughness(),
+        .metallic = material->GetMetallic(),
+        .transmission = material->GetTransmission(),
+        .indexOfRefraction = material->GetIndexOfRefraction(),
+        .albedoTextureIndex = AcquireTexture(albedoTexture),
+        .roughnessTextureIndex = AcquireTexture(roughnessTexture),
+    };
+    ReleaseTexture(slot.albedoTexture);
+    ReleaseTexture(slot.roughnessTexture);
+    slot.albedoTexture = albedoTexture;
+    slot.roughnessTexture = roughnessTexture;
+}
+
+uint32_t MaterialRegistry::Register(ScopedRefPtr<Material> material) {
+    const uint32_t slotIndex = static_cast<uint32_t>(mSlots.size());
+    mSlots.push_back(Slot{.material = material, .version = material->GetVersion()});
+    mProxies.emplace_back();
+    RefreshSlot(slotIndex);
+    return slotIndex;
+}
+
+void MaterialRegistry::Update(vk::CommandBuffer& commandBuffer) {
+    if (mSlots.empty()) {
+        return;
+    }
+
+    // Registering past the buffer's capacity moves everything to a bigger buffer, a fresh buffer
+    // is not read by any frame in flight so it goes through the upload manager
+    const vk::DeviceSize requiredSize = sizeof(MaterialProxy) * mProxies.size();
+    if (mMaterialsBuffer == nullptr || requiredSize > mMaterialsBuffer->GetBufferSize()) {
+        const vk::DeviceSize capacity = std::max(
+            requiredSize,
+            mMaterialsBuffer != nullptr ? mMaterialsBuffer->GetBufferSize() * 2 : 0);
+        mMaterialsBuffer = mContext->GetDevice()->CreateBuffer(
+            capacity,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+        for (uint32_t slotIndex = 0; slotIndex < mSlots.size(); ++slotIndex) {
+            if (mSlots[slotIndex].version != mSlots[slotIndex].material->GetVersion()) {
+                RefreshSlot(slotIndex);
+            }
+        }
+        mContext->GetUploadManager()->UploadBuffer(
+            mMaterialsBuffer,
+            mProxies.data(),
+            requiredSize);
+        mUploadedSlotCount = static_cast<uint32_t>(mSlots.size());
+        return;
+    }
+
+    // Gather contiguous runs of changed slots, each one becomes an inline buffer update
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Range> dirtyRanges;
+    for (uint32_t slotIndex = 0; slotIndex < mSlots.size(); ++slotIndex) {
+        const Slot& slot = mSlots[slotIndex];
+        const bool isNew = slotIndex >= mUploadedSlotCount;
+        if (slot.version != slot.material->GetVersion()) {
+            RefreshSlot(slotIndex);
+        } else if (!isNew) {
+            continue;
+        }
+        if (!dirtyRanges.empty() && dirtyRanges.back().end == slotIndex) {
+            dirtyRanges.back().end = slotIndex + 1;
+        } else {
+            dirtyRanges.push_back(Range{.begin = slotIndex, .end = slotIndex + 1});
+        }
+    }
+    mUploadedSlotCount = static_cast<uint32_t>(mSlots.size());
+    if (dirtyRanges.empty()) {
+        return;
+    }
+
+    // Frames still in flight may be reading the buffer
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        {},
+        {},
+        {});
+
+    // vkCmdUpdateBuffer is limited to 64KiB per call
+    constexpr uint32_t MaxSlotsPerUpdate = 65536 / sizeof(MaterialProxy);
+    for (const Range& range : dirtyRanges) {
+        for (uint32_t begin = range.begin; begin < range.end; begin += MaxSlotsPerUpdate) {
+            const uint32_t count = std::min(range.end - begin, MaxSlotsPerUpdate);
+            commandBuffer.updateBuffer(
+                mMaterialsBuffer->GetBufferHandle(),
+                sizeof(MaterialProxy) * begin,
+                sizeof(MaterialProxy) * count,
+                &mProxies[begin]);
+        }
+    }
+
+    vk::MemoryBarrier barrier = vk::MemoryBarrier()
+                                    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                    .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        {},
+        barrier,
+        {},
+        {});
+}
+
+MaterialRegistry::~MaterialRegistry() {}
+
+}  // namespace VKRT
@@ -0,0 +1,221 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "DebugUtils.h"
+
+namespace VKRT {
+
+namespace {
+vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+}  // namespace
+
+MemoryAllocator::MemoryAllocator(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice)
+    : mLogicalDevice(logicalDevice),
+      mMemoryProperties(physicalDevice.getMemoryProperties()),
+      mBlocks() {}
+
+vk::DeviceSize MemoryAllocator::GetPreferredBlockSize(uint32_t memoryTypeIndex) const {
+    // Small heaps (e.g. the 256MiB host visible device local window) get smaller blocks so a
+    // single block does not take a large share of them
+    const uint32_t heapIndex = mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const vk::DeviceSize heapSize = mMemoryProperties.memoryHeaps[heapIndex].size;
+    return std::min(DefaultBlockSize, heapSize / 8);
+}
+
+MemoryBlock* MemoryAllocator::CreateBlock(
+    uint32_t memoryTypeIndex,
+    MemoryResourceKind kind,
+    vk::DeviceSize size,
+    bool dedicated,
+    const vk::MemoryAllocateFlags& allocateFlags,
+    const void* allocateInfoNext) {
+    vk::MemoryAllocateFlagsInfo memoryAllocateFlagsInfo =
+        vk::MemoryAllocateFlagsInfo().setFlags(allocateFlags).setPNext(allocateInfoNext);
+    vk::MemoryAllocateInfo allocateInfo = vk::MemoryAllocateInfo()
+                                              .setAllocationSize(size)
+                                              .setMemoryTypeIndex(memoryTypeIndex)
+                                              .setPNext(allocateInfoNext);
+    if (allocateFlags != vk::MemoryAllocateFlags()) {
+        allocateInfo.setPNext(&memoryAllocateFlagsInfo);
+    }
+    const vk::DeviceMemory memory = VKRT_ASSERT_VK(mLogicalDevice.allocateMemory(allocateInfo));
+
+    // Host visible blocks stay mapped for their whole lifetime, suballocations just offset into
+    // the mapping
+    uint8_t* mappedData = nullptr;
+    if (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+        vk::MemoryPropertyFlagBits::eHostVisible) {
+        mappedData =
+            static_cast<uint8_t*>(VKRT_ASSERT_VK(mLogicalDevice.mapMemory(memory, 0, size)));
+    }
+
+    std::unique_ptr<MemoryBlock> block(new MemoryBlock{
+        .memory = memory,
+        .size = size,
+        .mappedData = mappedData,
+        .memoryTypeIndex = memoryTypeIndex,
+        .kind = kind,
+        .dedicated = dedicated,
+        .allocatedSize = 0,
+        .freeRanges = {{0, size}},
+    });
+    mBlocks.push_back(std::move(block));
+    return mBlocks.back().get();
+}
+
+void MemoryAllocator::DestroyBlock(MemoryBlock* block) {
+    if (block->mappedData != nullptr) {
+        mLogicalDevice.unmapMemory(block->memory);
+    }
+    mLogicalDevice.freeMemory(block->memory);
+    mBlocks.erase(std::find_if(
+        mBlocks.begin(),
+        mBlocks.end(),
+        [block](const std::unique_ptr<MemoryBlock>& other) { return other.get() == block; }));
+}
+
+bool MemoryAllocator::TryAllocateFromBlock(
+    MemoryBlock* block,
+    const vk::MemoryRequirements& requirements,
+    MemoryAllocation& allocation) {
+    // First fit over the free ranges, the alignment padding in front of the allocation goes
+    // back to the free list
+    for (auto range = block->freeRanges.begin(); range != block->freeRanges.end(); ++range) {
+        const vk::DeviceSize rangeBegin = range->first;
+        const vk::DeviceSize rangeEnd = range->first + range->second;
+        const vk::DeviceSize offset = AlignUp(rangeBegin, requirements.alignment);
+        if (offset + requirements.size > rangeEnd) {
+            continue;
+        }
+
+        block->freeRanges.erase(range);
+        if (offset > rangeBegin) {
+            block->freeRanges.emplace(rangeBegin, offset - rangeBegin);
+        }
+        if (offset + requirements.size < rangeEnd) {
+            block->freeRanges.emplace(
+                offset + requirements.size,
+                rangeEnd - (offset + requirements.size));
+        }
+        block->allocatedSize += requirements.size;
+
+        allocation = MemoryAllocation{
+            .memory = block->memory,
+            .offset = offset,
+            .size = requirements.size,
+            .mappedData = block->mappedData != nullptr ? block->mappedData + offset : nullptr,
+            .block = block,
+        };
+        return true;
+    }
+    return false;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const Request& request) {
+    const vk::DeviceSize blockSize = GetPreferredBlockSize(request.memoryTypeIndex);
+
+    // Buffers may need their device address, every linear block is allocated with it so any
+    // suballocation can be queried
+    const vk::MemoryAllocateFlags blockAllocateFlags =
+        request.kind == MemoryResourceKind::Linear ? vk::MemoryAllocateFlagBits::eDeviceAddress
+                                                   : vk::MemoryAllocateFlags{};
+
+    // Resources the driver wants on their own, or that would take most of a block, get a
+    // dedicated allocation that is released as soon as the resource is
+    if (request.dedicated || request.requirements.size > blockSize / 2) {
+        vk::MemoryDedicatedAllocateInfo dedicatedInfo = vk::MemoryDedicatedAllocateInfo()
+                                                            .setBuffer(request.dedicatedBuffer)
+                                                            .setImage(request.dedicatedImage);
+        MemoryBlock* block = CreateBlock(
+            request.memoryTypeIndex,
+            request.kind,
+            request.requirements.size,
+            true,
+            request.allocateFlags | blockAllocateFlags,
+            request.dedicated ? &dedicatedInfo : nullptr);
+        MemoryAllocation allocation;
+        const bool allocated = TryAllocateFromBlock(block, request.requirements, allocation);
+        VKRT_ASSERT(allocated);
+        return allocation;
+    }
+
+    for (const std::unique_ptr<MemoryBlock>& block : mBlocks) {
+        if (block->memoryTypeIndex != request.memoryTypeIndex || block->kind != request.kind ||
+            block->dedicated) {
+            continue;
+        }
+        MemoryAllocation allocation;
+        if (TryAllocateFromBlock(block.get(), request.requirements, allocation)) {
+            return allocation;
+        }
+    }
+
+    MemoryBlock* block = CreateBlock(
+        request.memoryTypeIndex,
+        request.kind,
+        blockSize,
+        false,
+        blockAllocateFlags,
+        nullptr);
+    MemoryAllocation allocation;
+    const bool allocated = TryAllocateFromBlock(block, request.requirements, allocation);
+    VKRT_ASSERT(allocated);
+    return allocation;
+}
+
+void MemoryAllocator::Free(const MemoryAllocation& allocation) {
+    MemoryBlock* block = allocation.block;
+    if (block == nullptr) {
+        return;
+    }
+
+    // Return the range and merge it with its neighbours
+    vk::DeviceSize rangeBegin = allocation.offset;
+    vk::DeviceSize rangeEnd = allocation.offset + allocation.size;
+    auto next = block->freeRanges.lower_bound(rangeBegin);
+    if (next != block->freeRanges.end() && next->first == rangeEnd) {
+        rangeEnd += next->second;
+        next = block->freeRanges.erase(next);
+    }
+    if (next != block->freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == rangeBegin) {
+            rangeBegin = previous->first;
+            block->freeRanges.erase(previous);
+        }
+    }
+    block->freeRanges.emplace(rangeBegin, rangeEnd - rangeBegin);
+    block->allocatedSize -= allocation.size;
+
+    if (block->allocatedSize > 0) {
+        return;
+    }
+
+    // Keep one empty block per pool around so allocation churn does not hit vkAllocateMemory,
+    // dedicated blocks are always released
+    const bool hasOtherEmptyBlock = std::any_of(
+        mBlocks.begin(),
+        mBlocks.end(),
+        [block](const std::unique_ptr<MemoryBlock>& other) {
+            return other.get() != block && other->memoryTypeIndex == block->memoryTypeIndex &&
+                   other->kind == block->kind && !other->dedicated && other->allocatedSize == 0;
+        });
+    if (block->dedicated || hasOtherEmptyBlock) {
+        DestroyBlock(block);
+    }
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    for (const std::unique_ptr<MemoryBlock>& block : mBlocks) {
+        if (block->mappedData != nullptr) {
+            mLogicalDevice.unmapMemory(block->memory);
+        }
+        mLogicalDevice.freeMemory(block->memory);
+    }
+}
+
+}  // namespace VKRT
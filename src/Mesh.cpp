@@ -1,8 +1,10 @@
 #include "Mesh.h"
 
+#include "BLASBuilder.h"
 #include "DebugUtils.h"
 #include "Material.h"
 #include "Texture.h"
+#include "UploadManager.h"
 
 namespace VKRT {
 
@@ -10,55 +12,48 @@ Mesh::Mesh(
     ScopedRefPtr<Context> context,
     const std::vector<Vertex>& vertices,
     const std::vector<glm::uvec3>& indices,
-    ScopedRefPtr<Material> material)
-    : mContext(context), mMaterial(material) {
+    ScopedRefPtr<Material> material,
+    BuildPolicy buildPolicy,
+    bool compactBLAS)
+    : mContext(context), mMaterial(material), mPositions(), mIndices(indices) {
+    mPositions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices) {
+        mPositions.push_back(vertex.position);
+    }
+
     uint32_t triangleCount = indices.size();
     VkTransformMatrixKHR transformMatrix =
         {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
 
-    {
-        const size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
-        mVertexBuffer = mContext->GetDevice()->CreateBuffer(
-            vertexBufferSize,
-            vk::BufferUsageFlagBits::eShaderDeviceAddress |
-                vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-            vk::MemoryAllocateFlagBits::eDeviceAddress);
-        uint8_t* bufferData = mVertexBuffer->MapBuffer();
-        std::copy_n(
-            reinterpret_cast<uint8_t const*>(vertices.data()),
-            vertexBufferSize,
-            bufferData);
-        mVertexBuffer->UnmapBuffer();
-    }
-
-    {
-        const size_t indexBufferSize = indices.size() * sizeof(glm::uvec3);
-        mIndexBuffer = mContext->GetDevice()->CreateBuffer(
-            indexBufferSize,
-            vk::BufferUsageFlagBits::eShaderDeviceAddress |
-                vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-            vk::MemoryAllocateFlagBits::eDeviceAddress);
-        uint8_t* bufferData = mIndexBuffer->MapBuffer();
-        std::copy_n(reinterpret_cast<uint8_t const*>(indices.data()), indexBufferSize, bufferData);
-        mIndexBuffer->UnmapBuffer();
-    }
+    // Geometry lives in device local memory, it is fetched by every closest hit. The copies are
+    // batched by the upload manager and the BLAS builder waits for them before building
+    const size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
+    const size_t indexBufferSize = indices.size() * sizeof(glm::uvec3);
+    const size_t transformBufferSize = sizeof(vk::TransformMatrixKHR);
+    const vk::BufferUsageFlags geometryUsage =
+        vk::BufferUsageFlagBits::eShaderDeviceAddress |
+        vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+        vk::BufferUsageFlagBits::eTransferDst;
+    mVertexBuffer = mContext->GetDevice()->CreateBuffer(
+        vertexBufferSize,
+        geometryUsage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        vk::MemoryAllocateFlagBits::eDeviceAddress);
+    mIndexBuffer = mContext->GetDevice()->CreateBuffer(
+        indexBufferSize,
+        geometryUsage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        vk::MemoryAllocateFlagBits::eDeviceAddress);
+    mTransformBuffer = mContext->GetDevice()->CreateBuffer(
+        transformBufferSize,
+        geometryUsage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        vk::MemoryAllocateFlagBits::eDeviceAddress);
 
-    {
-        mTransformBuffer = mContext->GetDevice()->CreateBuffer(
-            sizeof(vk::TransformMatrixKHR),
-            vk::BufferUsageFlagBits::eShaderDeviceAddress |
-                vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-            vk::MemoryAllocateFlagBits::eDeviceAddress);
-        uint8_t* bufferData = mTransformBuffer->MapBuffer();
-        std::copy_n(
-            reinterpret_cast<uint8_t*>(&transformMatrix),
-            sizeof(vk::TransformMatrixKHR),
-            bufferData);
-        mTransformBuffer->UnmapBuffer();
-    }
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->UploadBuffer(mVertexBuffer, vertices.data(), vertexBufferSize);
+    uploadManager->UploadBuffer(mIndexBuffer, indices.data(), indexBufferSize);
+    uploadManager->UploadBuffer(mTransformBuffer, &transformMatrix, transformBufferSize);
 
     vk::AccelerationStructureGeometryTrianglesDataKHR triangleData =
         vk::AccelerationStructureGeometryTrianglesDataKHR()
@@ -70,17 +65,38 @@ Mesh::Mesh(
             .setIndexData(mIndexBuffer->GetDeviceAddress())
             .setTransformData(mTransformBuffer->GetDeviceAddress());
 
-    vk::AccelerationStructureGeometryKHR accelerationStructureGeometry =
-        vk::AccelerationStructureGeometryKHR()
-            .setFlags(vk::GeometryFlagBitsKHR::eOpaque)
-            .setGeometryType(vk::GeometryTypeKHR::eTriangles)
-            .setGeometry(triangleData);
+    mBuildInput.geometry = vk::AccelerationStructureGeometryKHR()
+                               .setFlags(vk::GeometryFlagBitsKHR::eOpaque)
+                               .setGeometryType(vk::GeometryTypeKHR::eTriangles)
+                               .setGeometry(triangleData);
+    mBuildInput.range = vk::AccelerationStructureBuildRangeInfoKHR()
+                            .setPrimitiveCount(triangleCount)
+                            .setPrimitiveOffset(0)
+                            .setFirstVertex(0)
+                            .setTransformOffset(0);
+    switch (buildPolicy) {
+        case BuildPolicy::FastTrace:
+            mBuildInput.flags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+            break;
+        case BuildPolicy::FastBuild:
+            mBuildInput.flags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastBuild;
+            break;
+        case BuildPolicy::LowMemory:
+            mBuildInput.flags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
+                                vk::BuildAccelerationStructureFlagBitsKHR::eLowMemory;
+            compactBLAS = true;
+            break;
+    }
+    mBuildInput.compact = compactBLAS;
+    if (compactBLAS) {
+        mBuildInput.flags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction;
+    }
 
     vk::AccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo =
         vk::AccelerationStructureBuildGeometryInfoKHR()
             .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
-            .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace)
-            .setGeometries(accelerationStructureGeometry);
+            .setFlags(mBuildInput.flags)
+            .setGeometries(mBuildInput.geometry);
 
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
     vk::AccelerationStructureBuildSizesInfoKHR buildSizesInfo =
@@ -89,6 +105,7 @@ Mesh::Mesh(
             accelerationStructureBuildGeometryInfo,
             triangleCount,
             mContext->GetDevice()->GetDispatcher());
+    mBuildInput.scratchSize = buildSizesInfo.buildScratchSize;
 
     mBLASBuffer = mContext->GetDevice()->CreateBuffer(
         buildSizesInfo.accelerationStructureSize,
@@ -107,37 +124,26 @@ Mesh::Mesh(
         nullptr,
         mContext->GetDevice()->GetDispatcher()));
 
-    ScopedRefPtr<VulkanBuffer> scratchBuffer = mContext->GetDevice()->CreateBuffer(
-        buildSizesInfo.buildScratchSize,
-        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-        vk::MemoryPropertyFlagBits::eDeviceLocal,
-        vk::MemoryAllocateFlagBits::eDeviceAddress);
+    vk::AccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo =
+        vk::AccelerationStructureDeviceAddressInfoKHR().setAccelerationStructure(mBLAS);
+    mBLASAddress = logicalDevice.getAccelerationStructureAddressKHR(
+        accelerationDeviceAddressInfo,
+        mContext->GetDevice()->GetDispatcher());
 
-    vk::AccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo =
-        vk::AccelerationStructureBuildGeometryInfoKHR()
-            .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
-            .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace)
-            .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
-            .setDstAccelerationStructure(mBLAS)
-            .setGeometries(accelerationStructureGeometry)
-            .setScratchData(scratchBuffer->GetDeviceAddress());
-
-    vk::AccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo =
-        vk::AccelerationStructureBuildRangeInfoKHR()
-            .setPrimitiveCount(triangleCount)
-            .setPrimitiveOffset(0)
-            .setFirstVertex(0)
-            .setTransformOffset(0);
-
-    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
-    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
-    commandBuffer.buildAccelerationStructuresKHR(
-        accelerationBuildGeometryInfo,
-        &accelerationStructureBuildRangeInfo,
+    // The actual build is deferred so all meshes loaded together share one submission
+    mContext->GetBLASBuilder()->Enqueue(this);
+}
+
+void Mesh::SetCompactedBLAS(
+    vk::AccelerationStructureKHR compactedBLAS,
+    ScopedRefPtr<VulkanBuffer> compactedBLASBuffer) {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroyAccelerationStructureKHR(
+        mBLAS,
+        nullptr,
         mContext->GetDevice()->GetDispatcher());
-    VKRT_ASSERT_VK(commandBuffer.end());
-    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
-    mContext->GetDevice()->DestroyCommand(commandBuffer);
+    mBLAS = compactedBLAS;
+    mBLASBuffer = compactedBLASBuffer;
 
     vk::AccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo =
         vk::AccelerationStructureDeviceAddressInfoKHR().setAccelerationStructure(mBLAS);
@@ -9,7 +9,11 @@
 
 namespace VKRT {
 
-Model* Model::Load(ScopedRefPtr<Context> context, const std::string& path) {
+Model* Model::Load(
+    ScopedRefPtr<Context> context,
+    const std::string& path,
+    Mesh::BuildPolicy buildPolicy,
+    bool compactBLAS) {
     tinygltf::Model model;
     tinygltf::TinyGLTF loader;
     std::string err;
@@ -215,7 +219,8 @@ Model* Model::Load(ScopedRefPtr<Context> context, const std::string& path) {
                     material = new Material();
                 }
 
-                ScopedRefPtr<Mesh> mesh = new Mesh(context, vertices, indices, material);
+                ScopedRefPtr<Mesh> mesh =
+                    new Mesh(context, vertices, indices, material, buildPolicy, compactBLAS);
                 meshes.push_back(mesh);
             }
         }
@@ -13,7 +13,8 @@ Object::Object(ScopedRefPtr<Model> model)
       mTransform(1.0f),
       mPosition(0.0f),
       mEulerRotation(0.0f),
-      mScale(1.0f, 1.0f, 1.0f) {
+      mScale(1.0f, 1.0f, 1.0f),
+      mTransformDirty(true) {
     VKRT_ASSERT(model != nullptr);
 }
 
@@ -50,6 +51,7 @@ void Object::UpdateTransform() {
         glm::radians(mEulerRotation.z));
     glm::mat4 scale = glm::scale(glm::mat4(1.0f), mScale);
     mTransform = translate * rotate * scale;
+    mTransformDirty = true;
 }
 
 Object::~Object() {}
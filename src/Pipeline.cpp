@@ -1,5 +1,6 @@
 #include "Pipeline.h"
 
+#include <algorithm>
 #include <unordered_map>
 
 #include "Context.h"
@@ -9,7 +10,8 @@ namespace VKRT {
 Pipeline::Pipeline(
     ScopedRefPtr<Context> context,
     const std::vector<Descriptor>& descriptors,
-    const std::unordered_map<RayTracingStage, Resource::Id>& shaderResourcesMap)
+    const std::unordered_map<RayTracingStage, Resource::Id>& shaderResourcesMap,
+    const std::vector<vk::DescriptorSetLayout>& additionalSetLayouts)
     : mContext(context) {
     std::vector<vk::DescriptorSetLayoutBinding> descriptorBindings;
     std::vector<vk::DescriptorBindingFlags> bindingFlags;
@@ -66,16 +68,19 @@ Pipeline::Pipeline(
         {RayTracingStage::Generate, vk::ShaderStageFlagBits::eRaygenKHR},
         {RayTracingStage::Hit, vk::ShaderStageFlagBits::eClosestHitKHR},
         {RayTracingStage::Miss, vk::ShaderStageFlagBits::eMissKHR},
+        {RayTracingStage::ShadowMiss, vk::ShaderStageFlagBits::eMissKHR},
     };
 
-    std::array<RayTracingStage, 3> stageOrder{
+    std::array<RayTracingStage, 4> stageOrder{
         RayTracingStage::Generate,
         RayTracingStage::Hit,
         RayTracingStage::Miss,
+        RayTracingStage::ShadowMiss,
     };
 
     std::vector<vk::PipelineShaderStageCreateInfo> stageCreateInfos;
     std::vector<vk::RayTracingShaderGroupCreateInfoKHR> rayTracingGroupCreateInfos;
+    std::vector<RayTracingStage> groupStages;
     uint32_t shaderIndex = 0;
     for (const RayTracingStage stage : stageOrder) {
         if (mShaders.find(stage) != mShaders.end()) {
@@ -97,20 +102,31 @@ Pipeline::Pipeline(
                 groupCreateInfo.setType(vk::RayTracingShaderGroupTypeKHR::eGeneral);
             }
             rayTracingGroupCreateInfos.push_back(groupCreateInfo);
+            groupStages.push_back(stage);
             ++shaderIndex;
         }
     }
 
+    std::vector<vk::DescriptorSetLayout> setLayouts{mDescriptorLayout};
+    setLayouts.insert(setLayouts.end(), additionalSetLayouts.begin(), additionalSetLayouts.end());
     vk::PipelineLayoutCreateInfo layoutCreateInfo =
-        vk::PipelineLayoutCreateInfo().setSetLayouts(mDescriptorLayout);
+        vk::PipelineLayoutCreateInfo().setSetLayouts(setLayouts);
     mLayout = VKRT_ASSERT_VK(logicalDevice.createPipelineLayout(layoutCreateInfo));
 
+    // Rays are only traced from the raygen shader, hit and miss shaders never recurse. The stack
+    // size is set at bind time from the actual shaders instead of the driver's worst case
+    VKRT_ASSERT(
+        MaxRayRecursionDepth <=
+        mContext->GetDevice()->GetRayTracingProperties().maxRayRecursionDepth);
+    const vk::DynamicState dynamicState = vk::DynamicState::eRayTracingPipelineStackSizeKHR;
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo =
+        vk::PipelineDynamicStateCreateInfo().setDynamicStates(dynamicState);
     vk::RayTracingPipelineCreateInfoKHR rayTracingPipelineCreateInfo =
         vk::RayTracingPipelineCreateInfoKHR()
             .setStages(stageCreateInfos)
             .setGroups(rayTracingGroupCreateInfos)
-            .setMaxPipelineRayRecursionDepth(
-                mContext->GetDevice()->GetRayTracingProperties().maxRayRecursionDepth)
+            .setMaxPipelineRayRecursionDepth(MaxRayRecursionDepth)
+            .setPDynamicState(&dynamicStateCreateInfo)
             .setLayout(mLayout);
     mPipeline = VKRT_ASSERT_VK(logicalDevice.createRayTracingPipelineKHR(
         {},
@@ -119,20 +135,61 @@ Pipeline::Pipeline(
         nullptr,
         mContext->GetDevice()->GetDispatcher()));
 
+    {
+        vk::DeviceSize rayGenStackSize = 0;
+        vk::DeviceSize hitStackSize = 0;
+        vk::DeviceSize missStackSize = 0;
+        for (uint32_t groupIndex = 0; groupIndex < groupStages.size(); ++groupIndex) {
+            switch (groupStages[groupIndex]) {
+                case RayTracingStage::Generate:
+                    rayGenStackSize = std::max(
+                        rayGenStackSize,
+                        logicalDevice.getRayTracingShaderGroupStackSizeKHR(
+                            mPipeline,
+                            groupIndex,
+                            vk::ShaderGroupShaderKHR::eGeneral,
+                            mContext->GetDevice()->GetDispatcher()));
+                    break;
+                case RayTracingStage::Hit:
+                    hitStackSize = std::max(
+                        hitStackSize,
+                        logicalDevice.getRayTracingShaderGroupStackSizeKHR(
+                            mPipeline,
+                            groupIndex,
+                            vk::ShaderGroupShaderKHR::eClosestHit,
+                            mContext->GetDevice()->GetDispatcher()));
+                    break;
+                case RayTracingStage::Miss:
+                case RayTracingStage::ShadowMiss:
+                    missStackSize = std::max(
+                        missStackSize,
+                        logicalDevice.getRayTracingShaderGroupStackSizeKHR(
+                            mPipeline,
+                            groupIndex,
+                            vk::ShaderGroupShaderKHR::eGeneral,
+                            mContext->GetDevice()->GetDispatcher()));
+                    break;
+            }
+        }
+        mStackSize = static_cast<uint32_t>(
+            rayGenStackSize + MaxRayRecursionDepth * std::max(hitStackSize, missStackSize));
+    }
+
     vk::PhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingProperties =
         mContext->GetDevice()->GetRayTracingProperties();
     mHandleSize = rayTracingProperties.shaderGroupHandleSize;
     const size_t handleAlignment = rayTracingProperties.shaderGroupHandleAlignment;
     mHandleSizeAligned = (mHandleSize + handleAlignment - 1) & ~(handleAlignment - 1);
     const uint32_t groupCount = static_cast<uint32_t>(rayTracingGroupCreateInfos.size());
-    const size_t sbtSize = groupCount * mHandleSizeAligned;
 
+    // Handles come back tightly packed, every table entry has to start at an aligned offset
+    const size_t handleStorageSize = groupCount * mHandleSize;
     std::vector<uint8_t> shaderHandleStorage =
         VKRT_ASSERT_VK(logicalDevice.getRayTracingShaderGroupHandlesKHR<uint8_t>(
             mPipeline,
             0,
             groupCount,
-            sbtSize,
+            handleStorageSize,
             mContext->GetDevice()->GetDispatcher()));
 
     {
@@ -155,27 +212,27 @@ Pipeline::Pipeline(
             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
             vk::MemoryAllocateFlagBits::eDeviceAddress);
         uint8_t* rayHitTableData = mRayHitTable->MapBuffer();
-        std::copy_n(shaderHandleStorage.begin() + mHandleSizeAligned, mHandleSize, rayHitTableData);
+        std::copy_n(shaderHandleStorage.begin() + mHandleSize, mHandleSize, rayHitTableData);
         mRayHitTable->UnmapBuffer();
     }
 
-    uint32_t missTableCount = 0;
-    if (mShaders.find(RayTracingStage::Miss) != mShaders.end()) {
-        ++missTableCount;
-    }
+    // Miss groups follow the raygen and hit groups
+    const uint32_t missTableCount = groupCount - 2;
 
     {
         mRayMissTable = mContext->GetDevice()->CreateBuffer(
-            mHandleSize * missTableCount,
+            mHandleSizeAligned * missTableCount,
             vk::BufferUsageFlagBits::eShaderBindingTableKHR |
                 vk::BufferUsageFlagBits::eShaderDeviceAddress,
             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
             vk::MemoryAllocateFlagBits::eDeviceAddress);
         uint8_t* rayMissTableData = mRayMissTable->MapBuffer();
-        std::copy_n(
-            shaderHandleStorage.begin() + mHandleSizeAligned * (missTableCount + 1),
-            mHandleSize * missTableCount,
-            rayMissTableData);
+        for (uint32_t missIndex = 0; missIndex < missTableCount; ++missIndex) {
+            std::copy_n(
+                shaderHandleStorage.begin() + mHandleSize * (missIndex + 2),
+                mHandleSize,
+                rayMissTableData + mHandleSizeAligned * missIndex);
+        }
         mRayMissTable->UnmapBuffer();
     }
 
@@ -1,48 +1,189 @@
 #include "ProbeGrid.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "DebugUtils.h"
+
+#undef MemoryBarrier
+
 namespace VKRT {
 ProbeGrid::ProbeGrid(ScopedRefPtr<Context> context)
     : mContext(context),
-      mProbesTexture(nullptr),
+      mIrradianceTexture(nullptr),
+      mVisibilityTexture(nullptr),
+      mRayTexture(nullptr),
       mProbeGridBuffer(nullptr),
       mOrigin(0.0f, 20.0f, 0.0f),
       mSize(40.0f, 40.0f, 40.0f),
       mDimensions(8, 8, 8),
-      mResolution(64) {
-    const uint32_t horizontalResolution = mResolution * mDimensions.x;
-    const uint32_t verticalResolution = mResolution * mDimensions.y;
-    const uint32_t layerCount = mDimensions.z;
-
-    mProbesTexture = new Texture(
+      mRayRotation(1.0f),
+      mGenerator(0),
+      mUpdateCount(0) {
+    const uint32_t tilesWide = mDimensions.x * mDimensions.z;
+    const uint32_t tilesHigh = mDimensions.y;
+    // Cleared so probes read as black until their first update
+    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    mIrradianceTexture = Texture::CreateStorageImage(
         mContext,
-        horizontalResolution,
-        verticalResolution,
-        layerCount,
+        commandBuffer,
+        IrradianceResolution * tilesWide,
+        IrradianceResolution * tilesHigh,
         vk::Format::eR16G16B16A16Sfloat,
-        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage);
+        vk::ImageUsageFlagBits::eSampled);
+    mVisibilityTexture = Texture::CreateStorageImage(
+        mContext,
+        commandBuffer,
+        VisibilityResolution * tilesWide,
+        VisibilityResolution * tilesHigh,
+        vk::Format::eR16G16Sfloat,
+        vk::ImageUsageFlagBits::eSampled);
+    mRayTexture = Texture::CreateStorageImage(
+        mContext,
+        commandBuffer,
+        RaysPerProbe,
+        GetProbeCount(),
+        vk::Format::eR32G32B32A32Sfloat);
+    VKRT_ASSERT_VK(commandBuffer.end());
+    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
+    mContext->GetDevice()->DestroyCommand(commandBuffer);
+
+    // Clamped, every tile carries its own border so filtering never needs the neighbor
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    vk::SamplerCreateInfo samplerCreateInfo =
+        vk::SamplerCreateInfo()
+            .setMagFilter(vk::Filter::eLinear)
+            .setMinFilter(vk::Filter::eLinear)
+            .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+            .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+            .setCompareOp(vk::CompareOp::eNever)
+            .setMinLod(0.0f)
+            .setMaxLod(0.0f);
+    mSampler = VKRT_ASSERT_VK(logicalDevice.createSampler(samplerCreateInfo));
 
     mProbeGridBuffer = mContext->GetDevice()->CreateBuffer(
         sizeof(ProbeGrid::UniformData),
         vk::BufferUsageFlagBits::eUniformBuffer,
         vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    UpdateData();
+
+    const Pipeline::Descriptor storageImage{
+        .type = vk::DescriptorType::eStorageImage,
+        .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    const std::vector<Pipeline::Descriptor> descriptors{
+        storageImage,
+        storageImage,
+        storageImage,
+        Pipeline::Descriptor{
+            .type = vk::DescriptorType::eUniformBuffer,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute},
+    };
+    mUpdatePipeline = new ComputePipeline(
+        mContext,
+        descriptors,
+        Resource::Id::ProbeUpdateShader,
+        sizeof(UpdateConstants));
+    const auto storageImageInfo = [](const ScopedRefPtr<Texture>& texture) {
+        return vk::DescriptorImageInfo()
+            .setImageView(texture->GetImageView())
+            .setImageLayout(vk::ImageLayout::eGeneral);
+    };
+    mUpdateSet = mUpdatePipeline->CreateDescriptorSet({
+        {.image = storageImageInfo(mRayTexture)},
+        {.image = storageImageInfo(mIrradianceTexture)},
+        {.image = storageImageInfo(mVisibilityTexture)},
+        {.buffer = vk::DescriptorBufferInfo()
+                       .setBuffer(mProbeGridBuffer->GetBufferHandle())
+                       .setOffset(0)
+                       .setRange(sizeof(UniformData))},
+    });
+}
+
+void ProbeGrid::SetVolume(const glm::vec3& center, const glm::vec3& size) {
+    mOrigin = center;
+    mSize = size;
+    // Irradiance from the old volume is meaningless at the new probe positions
+    mUpdateCount = 0;
+    UpdateData();
 }
 
 void ProbeGrid::UpdateData() {
+    const glm::vec3 spacing = mSize / glm::vec3(glm::max(mDimensions, glm::uvec3(2)) - 1u);
+    const float minSpacing = glm::min(spacing.x, glm::min(spacing.y, spacing.z));
+    const float maxSpacing = glm::max(spacing.x, glm::max(spacing.y, spacing.z));
+
     uint8_t* buffer = mProbeGridBuffer->MapBuffer();
     UniformData data{
         .origin = mOrigin - mSize / 2.0f,
-        .size = mSize,
+        .normalBias = 0.25f * minSpacing,
+        .spacing = spacing,
+        .maxDistance = 1.5f * maxSpacing,
         .dimensions = mDimensions,
-        .resolution = mResolution,
+        .raysPerProbe = RaysPerProbe,
     };
     std::copy_n(reinterpret_cast<uint8_t*>(&data), sizeof(UniformData), buffer);
     mProbeGridBuffer->UnmapBuffer();
 }
 
-glm::uvec3 ProbeGrid::GetDispatchDimensions() {
-    return glm::uvec3(mResolution * mDimensions.x, mResolution * mDimensions.y, mDimensions.z);
+void ProbeGrid::BeginFrame() {
+    // Uniformly distributed rotation from three uniform numbers (Shoemake, Graphics Gems III)
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    const float u0 = distribution(mGenerator);
+    const float u1 = distribution(mGenerator) * glm::two_pi<float>();
+    const float u2 = distribution(mGenerator) * glm::two_pi<float>();
+    const float r0 = std::sqrt(1.0f - u0);
+    const float r1 = std::sqrt(u0);
+    const glm::quat rotation(
+        r1 * std::cos(u2),
+        r0 * std::sin(u1),
+        r0 * std::cos(u1),
+        r1 * std::sin(u2));
+    mRayRotation = glm::mat4_cast(rotation);
 }
 
-ProbeGrid::~ProbeGrid() {}
+void ProbeGrid::Update(vk::CommandBuffer& commandBuffer) {
+    // The first update after a reset replaces the cleared atlases outright
+    UpdateConstants constants{
+        .rayRotation = mRayRotation,
+        .updateVisibility = 0,
+        .hysteresis = mUpdateCount == 0 ? 0.0f : Hysteresis};
+    const uint32_t tilesWide = mDimensions.x * mDimensions.z;
+    mUpdatePipeline->Dispatch(
+        commandBuffer,
+        mUpdateSet,
+        IrradianceResolution * tilesWide,
+        IrradianceResolution * mDimensions.y,
+        &constants);
+    constants.updateVisibility = 1;
+    mUpdatePipeline->Dispatch(
+        commandBuffer,
+        mUpdateSet,
+        VisibilityResolution * tilesWide,
+        VisibilityResolution * mDimensions.y,
+        &constants);
+    ++mUpdateCount;
+
+    const vk::MemoryBarrier writeBarrier = vk::MemoryBarrier()
+                                               .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                               .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        {},
+        writeBarrier,
+        {},
+        {});
+}
+
+ProbeGrid::~ProbeGrid() {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroySampler(mSampler);
+}
 
-}  // namespace VKRT
\ No newline at end of file
+}  // namespace VKRT
@@ -0,0 +1,59 @@
+#include "RadianceCache.h"
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "VulkanBuffer.h"
+
+#undef MemoryBarrier
+
+namespace VKRT {
+
+RadianceCache::RadianceCache(ScopedRefPtr<Context> context) : mContext(context) {
+    const vk::DeviceSize bufferSize = sizeof(Entry) * Capacity;
+    mBuffer = mContext->GetDevice()->CreateBuffer(
+        bufferSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // A zero checksum marks a free slot
+    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    commandBuffer.fillBuffer(mBuffer->GetBufferHandle(), 0, bufferSize, 0);
+    VKRT_ASSERT_VK(commandBuffer.end());
+    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
+    mContext->GetDevice()->DestroyCommand(commandBuffer);
+
+    const std::vector<Pipeline::Descriptor> descriptors{
+        Pipeline::Descriptor{
+            .type = vk::DescriptorType::eStorageBuffer,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute},
+    };
+    mResolvePipeline =
+        new ComputePipeline(mContext, descriptors, Resource::Id::RadianceCacheResolveShader);
+    mResolveSet = mResolvePipeline->CreateDescriptorSet({{.buffer = mBuffer->GetDescriptorInfo()}});
+}
+
+void RadianceCache::Resolve(vk::CommandBuffer& commandBuffer) {
+    mResolvePipeline->Dispatch(
+        commandBuffer,
+        mResolveSet,
+        ResolveWidth,
+        Capacity / ResolveWidth);
+
+    const vk::AccessFlags shaderAccess =
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    const vk::MemoryBarrier resolveBarrier = vk::MemoryBarrier()
+                                                 .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                                 .setDstAccessMask(shaderAccess);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        {},
+        resolveBarrier,
+        {},
+        {});
+}
+
+RadianceCache::~RadianceCache() {}
+
+}  // namespace VKRT
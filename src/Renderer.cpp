@@ -1,16 +1,39 @@
 #include "Renderer.h"
 
-#include <random>
+#include <algorithm>
+#include <utility>
 
 #include "DebugUtils.h"
 #include "Texture.h"
 
+#undef MemoryBarrier
+
 namespace VKRT {
-Renderer::Renderer(ScopedRefPtr<Context> context, ScopedRefPtr<Scene> scene)
-    : mContext(context), mScene(scene), mCurrentMode(Renderer::Mode::Realtime), mCurrentTile(0) {
+Renderer::Renderer(
+    ScopedRefPtr<Context> context,
+    ScopedRefPtr<Scene> scene,
+    uint32_t framesInFlight)
+    : mContext(context),
+      mScene(scene),
+      mHistoryIndex(0),
+      mSceneBufferVersion(0),
+      mSceneTopologyVersion(0),
+      mCurrentFrame(0),
+      mCurrentMode(Renderer::Mode::Realtime),
+      mCurrentTile(0),
+      mMaxBounces(DefaultMaxBounces),
+      mFinalRenderMaxBounces(DefaultFinalRenderMaxBounces),
+      mFinalRenderErrorThreshold(DefaultFinalRenderErrorThreshold),
+      mRealtimeSamplerMode(Renderer::SamplerMode::Sobol),
+      mDenoiserEnabled(true),
+      mProbesEnabled(false),
+      mRadianceCacheEnabled(false),
+      mReSTIREnabled(false),
+      mFrameIndex(0),
+      mPreviousViewInverse(1.0f),
+      mPreviousViewProjection(1.0f) {
     ScopedRefPtr<InputManager> inputManager = mContext->GetWindow()->GetInputManager();
     inputManager->Subscribe(this);
-    constexpr uint32_t MaxBoundTextures = 64;
     {
         std::vector<Pipeline::Descriptor> descriptors{
             Pipeline::Descriptor{
@@ -21,7 +44,7 @@ Renderer::Renderer(ScopedRefPtr<Context> context, ScopedRefPtr<Scene> scene)
                 .type = vk::DescriptorType::eStorageImage,
                 .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
             Pipeline::Descriptor{
-                .type = vk::DescriptorType::eUniformBuffer,
+                .type = vk::DescriptorType::eUniformBufferDynamic,
                 .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
             Pipeline::Descriptor{
                 .type = vk::DescriptorType::eStorageBuffer,
@@ -33,71 +56,216 @@ Renderer::Renderer(ScopedRefPtr<Context> context, ScopedRefPtr<Scene> scene)
                 .type = vk::DescriptorType::eStorageBuffer,
                 .stageFlags = vk::ShaderStageFlagBits::eClosestHitKHR},
             Pipeline::Descriptor{
-                .type = vk::DescriptorType::eSampledImage,
-                .stageFlags = vk::ShaderStageFlagBits::eClosestHitKHR,
-                .count = MaxBoundTextures,
-                .variableCount = true},
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags =
+                    vk::ShaderStageFlagBits::eRaygenKHR | vk::ShaderStageFlagBits::eMissKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eCombinedImageSampler,
+                .stageFlags =
+                    vk::ShaderStageFlagBits::eRaygenKHR | vk::ShaderStageFlagBits::eMissKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eCombinedImageSampler,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eCombinedImageSampler,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eUniformBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageBuffer,
+                .stageFlags = vk::ShaderStageFlagBits::eRaygenKHR},
         };
 
         std::unordered_map<RayTracingStage, Resource::Id> stages{
             {RayTracingStage::Generate, Resource::Id::GenShader},
             {RayTracingStage::Hit, Resource::Id::HitShader},
             {RayTracingStage::Miss, Resource::Id::MissShader},
+            {RayTracingStage::ShadowMiss, Resource::Id::ShadowMissShader},
         };
 
-        mMainPassPipeline = new Pipeline(context, descriptors, stages);
+        // Scene textures live in the registry's bindless table, bound as set 1
+        mMainPassPipeline = new Pipeline(
+            context,
+            descriptors,
+            stages,
+            {mScene->GetMaterialRegistry()->GetTextureTable()->GetDescriptorLayout()});
+
+        stages[RayTracingStage::Generate] = Resource::Id::ProbeGenShader;
+        mProbePipeline = new Pipeline(
+            context,
+            descriptors,
+            stages,
+            {mScene->GetMaterialRegistry()->GetTextureTable()->GetDescriptorLayout()});
+
+        stages[RayTracingStage::Generate] = Resource::Id::ReSTIRInitialShader;
+        mReSTIRInitialPipeline = new Pipeline(
+            context,
+            descriptors,
+            stages,
+            {mScene->GetMaterialRegistry()->GetTextureTable()->GetDescriptorLayout()});
+    }
+    {
+        std::vector<Pipeline::Descriptor> descriptors{
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+            Pipeline::Descriptor{
+                .type = vk::DescriptorType::eStorageImage,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        };
+        mDisplayPipeline = new ComputePipeline(context, descriptors, Resource::Id::DisplayShader);
     }
-    CreateStorageImage();
+    CreateFrameResources(framesInFlight);
+    CreateAccumulationImages();
+    mDenoiser = new Denoiser(mContext, mAccumulationTextures);
+    mProbeGrid = new ProbeGrid(mContext);
+    mRadianceCache = new RadianceCache(mContext);
     CreateUniformBuffer();
     CreateMaterialUniforms();
+    mSamplerTables = new SamplerTables(mContext);
+    CreateReSTIRResources();
 }
 
-void Renderer::CreateStorageImage() {
-    Swapchain* swapchain = mContext->GetSwapchain();
-    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
-
-    const vk::Format swapchainFormat = swapchain->GetFormat();
-    const uint32_t swapchainWidth = swapchain->GetExtent().width;
-    const uint32_t swapchainHeight = swapchain->GetExtent().height;
-
-    mStorageTexture = new Texture(
+void Renderer::CreateFrameResources(uint32_t framesInFlight) {
+    VKRT_ASSERT(framesInFlight > 0);
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::Device& logicalDevice = device->GetLogicalDevice();
+    mFrames.resize(framesInFlight);
+    for (FrameResources& frame : mFrames) {
+        frame.commandBuffer = device->CreateCommandBuffer();
+        // Signaled so the first wait on every slot returns immediately
+        frame.fence = device->CreateFence(true);
+        frame.imageAcquiredSemaphore =
+            VKRT_ASSERT_VK(logicalDevice.createSemaphore(vk::SemaphoreCreateInfo{}));
+        frame.renderFinishedSemaphore =
+            VKRT_ASSERT_VK(logicalDevice.createSemaphore(vk::SemaphoreCreateInfo{}));
+    }
+    mUniformRing = new DynamicBufferRing(
         mContext,
-        swapchainWidth,
-        swapchainHeight,
-        swapchainFormat,
-        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eStorage);
+        UniformRingFrameSize,
+        framesInFlight,
+        vk::BufferUsageFlagBits::eUniformBuffer);
+}
 
+void Renderer::CreateAccumulationImages() {
+    const vk::Extent2D extent = mContext->GetSwapchain()->GetExtent();
     vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
     VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
-    mStorageTexture->SetImageLayout(
-        commandBuffer,
-        vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eGeneral,
-        vk::PipelineStageFlagBits::eAllCommands,
-        vk::PipelineStageFlagBits::eAllCommands);
+    // Cleared, tiles a final render hasn't reached yet are displayed as black and the first
+    // realtime frame finds no history
+    for (ScopedRefPtr<Texture>& accumulationTexture : mAccumulationTextures) {
+        accumulationTexture = Texture::CreateStorageImage(
+            mContext,
+            commandBuffer,
+            extent.width,
+            extent.height,
+            vk::Format::eR32G32B32A32Sfloat);
+    }
     VKRT_ASSERT_VK(commandBuffer.end());
     mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
     mContext->GetDevice()->DestroyCommand(commandBuffer);
 }
 
-struct LightMetadata {
-    uint32_t lightCount;
-    glm::vec3 sunDir;
-};
+void Renderer::CreateReSTIRResources() {
+    const vk::Extent2D extent = mContext->GetSwapchain()->GetExtent();
+    const vk::DeviceSize pixelCount = static_cast<vk::DeviceSize>(extent.width) * extent.height;
+    const vk::BufferUsageFlags usage =
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    mReSTIRSurfaceBuffer = device->CreateBuffer(
+        sizeof(ReSTIRSurface) * pixelCount,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    mTemporalReservoirBuffer = device->CreateBuffer(
+        sizeof(ReSTIRReservoir) * pixelCount,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    for (ScopedRefPtr<VulkanBuffer>& reservoirBuffer : mReservoirBuffers) {
+        reservoirBuffer = device->CreateBuffer(
+            sizeof(ReSTIRReservoir) * pixelCount,
+            usage,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }
 
-void Renderer::CreateUniformBuffer() {
-    {
-        mCameraUniformBuffer = mContext->GetDevice()->CreateBuffer(
-            sizeof(CameraProperties),
-            vk::BufferUsageFlagBits::eUniformBuffer,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    // Empty reservoirs have no samples, so the first frame finds nothing to reuse
+    vk::CommandBuffer commandBuffer = device->CreateCommandBuffer();
+    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+    for (const ScopedRefPtr<VulkanBuffer>& reservoirBuffer : mReservoirBuffers) {
+        commandBuffer.fillBuffer(reservoirBuffer->GetBufferHandle(), 0, VK_WHOLE_SIZE, 0);
     }
+    VKRT_ASSERT_VK(commandBuffer.end());
+    device->SubmitCommandAndFlush(commandBuffer);
+    device->DestroyCommand(commandBuffer);
 
+    const Pipeline::Descriptor storageBuffer{
+        .type = vk::DescriptorType::eStorageBuffer,
+        .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    mReSTIRSpatialPipeline = new ComputePipeline(
+        mContext,
+        {storageBuffer, storageBuffer, storageBuffer, storageBuffer},
+        Resource::Id::ReSTIRSpatialShader,
+        sizeof(ReSTIRSpatialConstants));
+
+    for (uint32_t historyIndex = 0; historyIndex < Denoiser::HistoryCount; ++historyIndex) {
+        mReSTIRSpatialSets[historyIndex] = mReSTIRSpatialPipeline->CreateDescriptorSet({
+            {.buffer = mReSTIRSurfaceBuffer->GetDescriptorInfo()},
+            {.buffer = mTemporalReservoirBuffer->GetDescriptorInfo()},
+            {.buffer = mReservoirBuffers[historyIndex]->GetDescriptorInfo()},
+            {.buffer = mSamplerTables->GetBuffer()->GetDescriptorInfo()},
+        });
+    }
+}
+
+void Renderer::CreateUniformBuffer() {
+    // A fresh buffer per topology change, frames in flight keep the one they bound alive
     {
         const std::vector<Mesh::Description> descriptions = mScene->GetDescriptions();
         const size_t descriptionsBufferSize = sizeof(Mesh::Description) * descriptions.size();
         mSceneUniformBuffer = mContext->GetDevice()->CreateBuffer(
-            descriptionsBufferSize,
+            std::max(descriptionsBufferSize, sizeof(Mesh::Description)),
             vk::BufferUsageFlagBits::eStorageBuffer,
             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
         uint8_t* buffer = mSceneUniformBuffer->MapBuffer();
@@ -107,6 +275,8 @@ void Renderer::CreateUniformBuffer() {
             buffer);
         mSceneUniformBuffer->UnmapBuffer();
     }
+    ++mSceneBufferVersion;
+    mSceneTopologyVersion = mScene->GetTopologyVersion();
 }
 
 void Renderer::CreateMaterialUniforms() {
@@ -132,202 +302,542 @@ void Renderer::CreateMaterialUniforms() {
     }
 }
 
-void Renderer::UpdateCameraUniforms(Camera* camera) {
-    uint8_t* buffer = mCameraUniformBuffer->MapBuffer();
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<double> dis(0.0, std::numeric_limits<uint32_t>::max());
+uint32_t Renderer::UpdateCameraUniforms(Camera* camera) {
+    const SamplerMode samplerMode =
+        mCurrentMode == Renderer::Mode::Realtime ? mRealtimeSamplerMode : SamplerMode::Sobol;
+    const glm::mat4 viewInverse = glm::inverse(camera->GetViewTransform());
+    const glm::mat4 viewProjection =
+        camera->GetProjectionTransform() * camera->GetViewTransform();
+    if (mFrameIndex == 0) {
+        mPreviousViewInverse = viewInverse;
+        mPreviousViewProjection = viewProjection;
+    }
     CameraProperties cameraMatrices{
-        .viewInverse = glm::inverse(camera->GetViewTransform()),
+        .viewInverse = viewInverse,
         .projInverse = glm::inverse(camera->GetProjectionTransform()),
+        .previousViewInverse = mPreviousViewInverse,
+        .previousViewProjection = mPreviousViewProjection,
+        .probeRayRotation = mProbeGrid->GetRayRotation(),
         .framesSinceMoved = camera->GetFramesSinceMoved(),
-        .randomSeed = static_cast<uint32_t>(dis(gen)),
+        .frameIndex = mFrameIndex,
+        .samplerMode = static_cast<uint32_t>(samplerMode),
         .currentMode = static_cast<uint32_t>(mCurrentMode),
         .currentTile = mCurrentTile,
         .tileSize = mCurrentMode == Renderer::Mode::Realtime
                         ? 1
                         : mContext->GetSwapchain()->GetExtent().height / TileCount,
-        .tileCount = TileCount
+        .tileCount = TileCount,
+        .maxBounces =
+            mCurrentMode == Renderer::Mode::Realtime ? mMaxBounces : mFinalRenderMaxBounces,
+        .errorThreshold =
+            mCurrentMode == Renderer::Mode::Realtime ? 0.0f : mFinalRenderErrorThreshold,
+        .probesEnabled = IsTracingProbes() ? 1u : 0u,
+        .radianceCacheEnabled = IsUsingRadianceCache() ? 1u : 0u,
+        .restirEnabled = IsResampling() ? 1u : 0u
     };
-    std::copy_n(reinterpret_cast<uint8_t*>(&cameraMatrices), sizeof(CameraProperties), buffer);
-    mCameraUniformBuffer->UnmapBuffer();
-}
-
-void Renderer::UpdateMaterialUniforms(const Scene::SceneMaterials& materialInfo) {
-    {
-        const size_t materialBufferSize =
-            sizeof(Scene::MaterialProxy) * materialInfo.materials.size();
-        if (mMaterialsBuffer == nullptr ||
-            materialBufferSize != mMaterialsBuffer->GetBufferSize()) {
-            mMaterialsBuffer = mContext->GetDevice()->CreateBuffer(
-                materialBufferSize,
-                vk::BufferUsageFlagBits::eStorageBuffer,
-                vk::MemoryPropertyFlagBits::eHostVisible |
-                    vk::MemoryPropertyFlagBits::eHostCoherent);
-        }
-        uint8_t* buffer = mMaterialsBuffer->MapBuffer();
-        std::copy_n(
-            reinterpret_cast<const uint8_t*>(materialInfo.materials.data()),
-            materialBufferSize,
-            buffer);
-        mMaterialsBuffer->UnmapBuffer();
-    }
+    mPreviousViewInverse = viewInverse;
+    mPreviousViewProjection = viewProjection;
+    ++mFrameIndex;
+    return mUniformRing->Push(cameraMatrices);
 }
 
-void Renderer::CreateDescriptors(const Scene::SceneMaterials& materialInfo) {
+void Renderer::CreateDescriptors() {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
     {
+        // One set per pass and frame slot, a set can't be rewritten while a frame in flight uses
+        // it
+        const uint32_t setCount = static_cast<uint32_t>(mFrames.size());
+        std::vector<vk::DescriptorPoolSize> poolSizes = mMainPassPipeline->GetDescriptorSizes();
+        const std::vector<vk::DescriptorPoolSize>& displayPoolSizes =
+            mDisplayPipeline->GetDescriptorSizes();
+        poolSizes.insert(poolSizes.end(), displayPoolSizes.begin(), displayPoolSizes.end());
+        for (vk::DescriptorPoolSize& poolSize : poolSizes) {
+            poolSize.descriptorCount *= setCount;
+        }
         vk::DescriptorPoolCreateInfo poolCreateInfo =
-            vk::DescriptorPoolCreateInfo()
-                .setPoolSizes(mMainPassPipeline->GetDescriptorSizes())
-                .setMaxSets(1);
+            vk::DescriptorPoolCreateInfo().setPoolSizes(poolSizes).setMaxSets(2 * setCount);
         mDescriptorPool = VKRT_ASSERT_VK(logicalDevice.createDescriptorPool(poolCreateInfo));
 
-        std::vector<uint32_t> descriptorCounts{static_cast<uint32_t>(materialInfo.textures.size())};
-        vk::DescriptorSetVariableDescriptorCountAllocateInfo dynamicCountInfo =
-            vk::DescriptorSetVariableDescriptorCountAllocateInfo().setDescriptorCounts(
-                descriptorCounts);
-
+        std::vector<vk::DescriptorSetLayout> setLayouts(
+            setCount,
+            mMainPassPipeline->GetDescriptorLayout());
+        setLayouts.insert(setLayouts.end(), setCount, mDisplayPipeline->GetDescriptorLayout());
         vk::DescriptorSetAllocateInfo descriptorAllocateInfo =
             vk::DescriptorSetAllocateInfo()
                 .setDescriptorPool(mDescriptorPool)
-                .setSetLayouts(mMainPassPipeline->GetDescriptorLayout())
-                .setPNext(&dynamicCountInfo);
-        mDescriptorSet = VKRT_ASSERT_VK(logicalDevice.allocateDescriptorSets(
-                                            descriptorAllocateInfo,
-                                            mContext->GetDevice()->GetDispatcher()))
-                             .front();
+                .setSetLayouts(setLayouts);
+        std::vector<vk::DescriptorSet> descriptorSets =
+            VKRT_ASSERT_VK(logicalDevice.allocateDescriptorSets(
+                descriptorAllocateInfo,
+                mContext->GetDevice()->GetDispatcher()));
+        for (uint32_t setIndex = 0; setIndex < setCount; ++setIndex) {
+            mFrames[setIndex].descriptorSet = descriptorSets[setIndex];
+            mFrames[setIndex].displayDescriptorSet = descriptorSets[setCount + setIndex];
+        }
+    }
+
+    // Bindings that never change are written once per set
+    for (FrameResources& frame : mFrames) {
+        const vk::DescriptorBufferInfo cameraBufferInfo =
+            mUniformRing->GetDescriptorInfo(sizeof(CameraProperties));
+        vk::WriteDescriptorSet cameraUniformBufferWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(2)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+                .setBufferInfo(cameraBufferInfo);
+
+        auto sampler = vk::DescriptorImageInfo().setSampler(mTextureSampler);
+        vk::WriteDescriptorSet samplerWrite = vk::WriteDescriptorSet()
+                                                  .setDstSet(frame.descriptorSet)
+                                                  .setDstBinding(4)
+                                                  .setDescriptorCount(1)
+                                                  .setDescriptorType(vk::DescriptorType::eSampler)
+                                                  .setImageInfo(sampler);
+
+        vk::WriteDescriptorSet samplerTablesWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(8)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setBufferInfo(mSamplerTables->GetBuffer()->GetDescriptorInfo());
+
+        // Denoiser albedo, the other AOVs are per history and bound in UpdateDescriptors
+        vk::DescriptorImageInfo albedoImageInfo =
+            vk::DescriptorImageInfo()
+                .setImageView(mDenoiser->GetAlbedoTexture()->GetImageView())
+                .setImageLayout(vk::ImageLayout::eGeneral);
+        vk::WriteDescriptorSet albedoImageWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(9)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageImage)
+                .setImageInfo(albedoImageInfo);
+
+        // Probe atlases, the probe ray image and the grid description
+        const vk::DescriptorImageInfo irradianceInfo =
+            vk::DescriptorImageInfo()
+                .setSampler(mProbeGrid->GetSampler())
+                .setImageView(mProbeGrid->GetIrradianceTexture()->GetImageView())
+                .setImageLayout(vk::ImageLayout::eGeneral);
+        vk::WriteDescriptorSet irradianceWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(17)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                .setImageInfo(irradianceInfo);
+        const vk::DescriptorImageInfo visibilityInfo =
+            vk::DescriptorImageInfo()
+                .setSampler(mProbeGrid->GetSampler())
+                .setImageView(mProbeGrid->GetVisibilityTexture()->GetImageView())
+                .setImageLayout(vk::ImageLayout::eGeneral);
+        vk::WriteDescriptorSet visibilityWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(18)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                .setImageInfo(visibilityInfo);
+        const vk::DescriptorImageInfo probeRayInfo =
+            vk::DescriptorImageInfo()
+                .setImageView(mProbeGrid->GetRayTexture()->GetImageView())
+                .setImageLayout(vk::ImageLayout::eGeneral);
+        vk::WriteDescriptorSet probeRayWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(19)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageImage)
+                .setImageInfo(probeRayInfo);
+        const vk::DescriptorBufferInfo probeGridInfo =
+            vk::DescriptorBufferInfo()
+                .setBuffer(mProbeGrid->GetDescriptionBuffer()->GetBufferHandle())
+                .setOffset(0)
+                .setRange(sizeof(ProbeGrid::UniformData));
+        vk::WriteDescriptorSet probeGridWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(20)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eUniformBuffer)
+                .setBufferInfo(probeGridInfo);
+
+        vk::WriteDescriptorSet radianceCacheWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(21)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setBufferInfo(mRadianceCache->GetBuffer()->GetDescriptorInfo());
+
+        vk::WriteDescriptorSet restirSurfaceWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(22)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setBufferInfo(mReSTIRSurfaceBuffer->GetDescriptorInfo());
+        vk::WriteDescriptorSet temporalReservoirWrite =
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(23)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setBufferInfo(mTemporalReservoirBuffer->GetDescriptorInfo());
+
+        const std::vector<vk::WriteDescriptorSet> writeDescriptorSets{
+            cameraUniformBufferWrite,
+            samplerWrite,
+            samplerTablesWrite,
+            albedoImageWrite,
+            irradianceWrite,
+            visibilityWrite,
+            probeRayWrite,
+            probeGridWrite,
+            radianceCacheWrite,
+            restirSurfaceWrite,
+            temporalReservoirWrite};
+        logicalDevice.updateDescriptorSets(writeDescriptorSets, {});
     }
 }
 
-void Renderer::UpdateDescriptors(const Scene::SceneMaterials& materialInfo) {
+void Renderer::UpdateDescriptors(FrameResources& frame) {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
 
+    const vk::AccelerationStructureKHR& tlas = mScene->GetTLAS();
     vk::WriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructureInfo =
-        vk::WriteDescriptorSetAccelerationStructureKHR().setAccelerationStructures(
-            mScene->GetTLAS());
-    vk::WriteDescriptorSet accelerationStructureWrite =
-        vk::WriteDescriptorSet()
-            .setDstSet(mDescriptorSet)
-            .setDstBinding(0)
-            .setDescriptorCount(1)
-            .setDescriptorType(vk::DescriptorType::eAccelerationStructureKHR)
-            .setPNext(&descriptorAccelerationStructureInfo);
-
-    vk::DescriptorImageInfo storageImageInfo = vk::DescriptorImageInfo()
-                                                   .setImageView(mStorageTexture->GetImageView())
-                                                   .setImageLayout(vk::ImageLayout::eGeneral);
-    vk::WriteDescriptorSet imageWrite = vk::WriteDescriptorSet()
-                                            .setDstSet(mDescriptorSet)
-                                            .setDstBinding(1)
-                                            .setDescriptorCount(1)
-                                            .setDescriptorType(vk::DescriptorType::eStorageImage)
-                                            .setImageInfo(storageImageInfo);
-
-    vk::WriteDescriptorSet cameraUniformBufferWrite =
-        vk::WriteDescriptorSet()
-            .setDstSet(mDescriptorSet)
-            .setDstBinding(2)
-            .setDescriptorCount(1)
-            .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-            .setBufferInfo(mCameraUniformBuffer->GetDescriptorInfo());
-
-    vk::WriteDescriptorSet sceneUniformBufferWrite =
-        vk::WriteDescriptorSet()
-            .setDstSet(mDescriptorSet)
-            .setDstBinding(3)
-            .setDescriptorCount(1)
-            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
-            .setBufferInfo(mSceneUniformBuffer->GetDescriptorInfo());
-
-    auto sampler = vk::DescriptorImageInfo().setSampler(mTextureSampler);
-    vk::WriteDescriptorSet samplerWrite = vk::WriteDescriptorSet()
-                                              .setDstSet(mDescriptorSet)
-                                              .setDstBinding(4)
+        vk::WriteDescriptorSetAccelerationStructureKHR().setAccelerationStructures(tlas);
+    if (frame.boundTLASVersion != mScene->GetTLASVersion()) {
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(0)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(
+                                              vk::DescriptorType::eAccelerationStructureKHR)
+                                          .setPNext(&descriptorAccelerationStructureInfo));
+        frame.boundTLASVersion = mScene->GetTLASVersion();
+    }
+
+    if (frame.boundSceneVersion != mSceneBufferVersion) {
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(3)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setBufferInfo(frame.sceneBuffer->GetDescriptorInfo()));
+        frame.boundSceneVersion = mSceneBufferVersion;
+    }
+
+    vk::DescriptorBufferInfo materialsBufferInfo;
+    if (frame.materialsBuffer != nullptr &&
+        frame.boundMaterialsBuffer != frame.materialsBuffer->GetBufferHandle()) {
+        materialsBufferInfo = vk::DescriptorBufferInfo()
+                                  .setBuffer(frame.materialsBuffer->GetBufferHandle())
+                                  .setOffset(0)
+                                  .setRange(VK_WHOLE_SIZE);
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(5)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setBufferInfo(materialsBufferInfo));
+        frame.boundMaterialsBuffer = frame.materialsBuffer->GetBufferHandle();
+    }
+
+    vk::DescriptorBufferInfo emissiveTrianglesBufferInfo;
+    if (frame.emissiveTrianglesBuffer != nullptr &&
+        frame.boundEmissiveTrianglesBuffer != frame.emissiveTrianglesBuffer->GetBufferHandle()) {
+        emissiveTrianglesBufferInfo =
+            vk::DescriptorBufferInfo()
+                .setBuffer(frame.emissiveTrianglesBuffer->GetBufferHandle())
+                .setOffset(0)
+                .setRange(VK_WHOLE_SIZE);
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(6)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setBufferInfo(emissiveTrianglesBufferInfo));
+        frame.boundEmissiveTrianglesBuffer = frame.emissiveTrianglesBuffer->GetBufferHandle();
+    }
+
+    vk::DescriptorBufferInfo lightsBufferInfo;
+    if (frame.lightsBuffer != nullptr &&
+        frame.boundLightsBuffer != frame.lightsBuffer->GetBufferHandle()) {
+        lightsBufferInfo = vk::DescriptorBufferInfo()
+                               .setBuffer(frame.lightsBuffer->GetBufferHandle())
+                               .setOffset(0)
+                               .setRange(VK_WHOLE_SIZE);
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(7)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setBufferInfo(lightsBufferInfo));
+        frame.boundLightsBuffer = frame.lightsBuffer->GetBufferHandle();
+    }
+
+    vk::DescriptorBufferInfo environmentBufferInfo;
+    if (frame.environmentBuffer != nullptr &&
+        frame.boundEnvironmentBuffer != frame.environmentBuffer->GetBufferHandle()) {
+        environmentBufferInfo = vk::DescriptorBufferInfo()
+                                    .setBuffer(frame.environmentBuffer->GetBufferHandle())
+                                    .setOffset(0)
+                                    .setRange(VK_WHOLE_SIZE);
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.descriptorSet)
+                                          .setDstBinding(15)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setBufferInfo(environmentBufferInfo));
+        frame.boundEnvironmentBuffer = frame.environmentBuffer->GetBufferHandle();
+    }
+
+    vk::DescriptorImageInfo skyImageInfo;
+    if (frame.environment != nullptr &&
+        frame.boundSkyImage != frame.environment->GetSkyTexture()->GetImageView()) {
+        skyImageInfo = vk::DescriptorImageInfo()
+                           .setSampler(frame.environment->GetSkySampler())
+                           .setImageView(frame.environment->GetSkyTexture()->GetImageView())
+                           .setImageLayout(vk::ImageLayout::eGeneral);
+        writeDescriptorSets.push_back(
+            vk::WriteDescriptorSet()
+                .setDstSet(frame.descriptorSet)
+                .setDstBinding(16)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                .setImageInfo(skyImageInfo));
+        frame.boundSkyImage = frame.environment->GetSkyTexture()->GetImageView();
+    }
+
+    // The swapchain hands out a different image every frame
+    const vk::ImageView& outputImage = mContext->GetSwapchain()->GetCurrentImage()->GetImageView();
+    vk::DescriptorImageInfo outputImageInfo = vk::DescriptorImageInfo()
+                                                  .setImageView(outputImage)
+                                                  .setImageLayout(vk::ImageLayout::eGeneral);
+    if (frame.boundOutputImage != outputImage) {
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.displayDescriptorSet)
+                                          .setDstBinding(1)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageImage)
+                                          .setImageInfo(outputImageInfo));
+        frame.boundOutputImage = outputImage;
+    }
+
+    // Current frame's history at 1, 10, 11 and 24, last frame's at 12 to 14 and 25
+    std::vector<vk::DescriptorImageInfo> historyImageInfos;
+    std::array<vk::DescriptorBufferInfo, 2> reservoirBufferInfos;
+    if (frame.boundHistoryIndex != mHistoryIndex) {
+        const uint32_t previousIndex = (mHistoryIndex + 1) % Denoiser::HistoryCount;
+        const std::vector<std::pair<uint32_t, ScopedRefPtr<Texture>>> historyBindings{
+            {1, mAccumulationTextures[mHistoryIndex]},
+            {10, mDenoiser->GetNormalDepthTexture(mHistoryIndex)},
+            {11, mDenoiser->GetMomentsTexture(mHistoryIndex)},
+            {12, mAccumulationTextures[previousIndex]},
+            {13, mDenoiser->GetNormalDepthTexture(previousIndex)},
+            {14, mDenoiser->GetMomentsTexture(previousIndex)}};
+        // Writes point into this vector, it can't reallocate once they are recorded
+        historyImageInfos.reserve(historyBindings.size());
+        for (const auto& [binding, texture] : historyBindings) {
+            historyImageInfos.push_back(vk::DescriptorImageInfo()
+                                            .setImageView(texture->GetImageView())
+                                            .setImageLayout(vk::ImageLayout::eGeneral));
+            writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                              .setDstSet(frame.descriptorSet)
+                                              .setDstBinding(binding)
+                                              .setDescriptorCount(1)
+                                              .setDescriptorType(vk::DescriptorType::eStorageImage)
+                                              .setImageInfo(historyImageInfos.back()));
+        }
+        reservoirBufferInfos[0] = mReservoirBuffers[mHistoryIndex]->GetDescriptorInfo();
+        reservoirBufferInfos[1] = mReservoirBuffers[previousIndex]->GetDescriptorInfo();
+        for (uint32_t reservoirIndex = 0; reservoirIndex < reservoirBufferInfos.size();
+             ++reservoirIndex) {
+            writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                              .setDstSet(frame.descriptorSet)
+                                              .setDstBinding(24 + reservoirIndex)
                                               .setDescriptorCount(1)
-                                              .setDescriptorType(vk::DescriptorType::eSampler)
-                                              .setImageInfo(sampler);
-
-    vk::WriteDescriptorSet materialsWrite =
-        vk::WriteDescriptorSet()
-            .setDstSet(mDescriptorSet)
-            .setDstBinding(5)
-            .setDescriptorCount(1)
-            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
-            .setBufferInfo(mMaterialsBuffer->GetDescriptorInfo());
-
-    std::vector<vk::DescriptorImageInfo> imageInfos;
-    for (const Texture* texture : materialInfo.textures) {
-        imageInfos.push_back(vk::DescriptorImageInfo()
-                                 .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-                                 .setImageView(texture->GetImageView())
-                                 .setSampler(nullptr));
+                                              .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                              .setBufferInfo(reservoirBufferInfos[reservoirIndex]));
+        }
+        frame.boundHistoryIndex = mHistoryIndex;
+    }
+
+    const vk::ImageView& displayInput =
+        IsDenoising() ? mDenoiser->GetOutputTexture()->GetImageView()
+                      : mAccumulationTextures[mHistoryIndex]->GetImageView();
+    vk::DescriptorImageInfo displayInputInfo = vk::DescriptorImageInfo()
+                                                   .setImageView(displayInput)
+                                                   .setImageLayout(vk::ImageLayout::eGeneral);
+    if (frame.boundDisplayInput != displayInput) {
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet()
+                                          .setDstSet(frame.displayDescriptorSet)
+                                          .setDstBinding(0)
+                                          .setDescriptorCount(1)
+                                          .setDescriptorType(vk::DescriptorType::eStorageImage)
+                                          .setImageInfo(displayInputInfo));
+        frame.boundDisplayInput = displayInput;
     }
 
-    vk::WriteDescriptorSet texturesWrite = vk::WriteDescriptorSet()
-                                               .setDstSet(mDescriptorSet)
-                                               .setDstBinding(6)
-                                               .setDescriptorType(vk::DescriptorType::eSampledImage)
-                                               .setImageInfo(imageInfos)
-                                               .setDstArrayElement(0)
-                                               .setPBufferInfo(nullptr)
-                                               .setPTexelBufferView(nullptr);
-
-    std::vector<vk::WriteDescriptorSet> writeDescriptorSets{
-        accelerationStructureWrite,
-        imageWrite,
-        cameraUniformBufferWrite,
-        sceneUniformBufferWrite,
-        samplerWrite,
-        materialsWrite,
-        texturesWrite};
-
-    logicalDevice.updateDescriptorSets(writeDescriptorSets, {});
+    if (!writeDescriptorSets.empty()) {
+        logicalDevice.updateDescriptorSets(writeDescriptorSets, {});
+    }
 }
 
 void Renderer::Render(Camera* camera) {
-    mContext->GetSwapchain()->AcquireNextImage();
-    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
+    FrameResources& frame = mFrames[mCurrentFrame];
+    vk::CommandBuffer& commandBuffer = frame.commandBuffer;
+
+    // Only block when the GPU is a full ring behind, everything this slot owns is free to reuse
+    // once its fence signals
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    device->WaitForFence(frame.fence);
+    VKRT_ASSERT_VK(device->GetLogicalDevice().resetFences(frame.fence));
+    // Texture slots retired by frames that have now all completed become reusable
+    ScopedRefPtr<MaterialRegistry> materialRegistry = mScene->GetMaterialRegistry();
+    materialRegistry->GetTextureTable()->BeginFrame(static_cast<uint32_t>(mFrames.size()));
+
+    mContext->GetSwapchain()->AcquireNextImage(frame.imageAcquiredSemaphore);
     {
-        VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
+        VKRT_ASSERT_VK(commandBuffer.reset());
+        VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo().setFlags(
+            vk::CommandBufferUsageFlagBits::eOneTimeSubmit)));
+
+        // Realtime frames write the other history than the last one and read it back reprojected.
+        // Tiles of a final render keep accumulating into the same one
+        if (mCurrentMode == Renderer::Mode::Realtime) {
+            mHistoryIndex = (mHistoryIndex + 1) % Denoiser::HistoryCount;
+        }
 
         // Create and update all buffers and textures
+        mUniformRing->BeginFrame(mCurrentFrame);
+        uint32_t cameraOffset = 0;
+        // UpdateCameraUniforms advances the counter, the spatial pass must see the raygen value
+        const uint32_t frameIndex = mFrameIndex;
         {
-            mScene->Update(commandBuffer);
-            Scene::SceneMaterials materials = mScene->GetMaterialProxies();
-            UpdateMaterialUniforms(materials);
-            UpdateCameraUniforms(camera);
-            if (!mDescriptorSet) {
-                CreateDescriptors(materials);
+            mScene->Update(commandBuffer, frame.instanceBuffer);
+            materialRegistry->Update(commandBuffer);
+            // Objects added since the last frame get instance indices past the old descriptions
+            if (mScene->GetTopologyVersion() != mSceneTopologyVersion) {
+                CreateUniformBuffer();
+            }
+            frame.sceneBuffer = mSceneUniformBuffer;
+            // Holding the buffer keeps it alive until this slot is recycled, even if the registry
+            // has moved to a bigger one in the meantime
+            frame.materialsBuffer = materialRegistry->GetMaterialsBuffer();
+            frame.emissiveTrianglesBuffer = mScene->GetEmissiveLightTable()->GetLightsBuffer();
+            frame.lightsBuffer = mScene->GetLightsBuffer();
+            frame.environment = mScene->GetEnvironment();
+            frame.environmentBuffer = frame.environment->GetBuffer();
+            if (IsTracingProbes()) {
+                mProbeGrid->BeginFrame();
+            }
+            cameraOffset = UpdateCameraUniforms(camera);
+            if (!mDescriptorPool) {
+                CreateDescriptors();
             }
-            UpdateDescriptors(materials);
+            UpdateDescriptors(frame);
         }
 
         const vk::Extent2D& imageSize = mContext->GetSwapchain()->GetExtent();
 
+        // Last frame's denoise and display passes read the images this frame writes
+        const vk::AccessFlags shaderAccess =
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+        const vk::MemoryBarrier historyBarrier =
+            vk::MemoryBarrier().setSrcAccessMask(shaderAccess).setDstAccessMask(shaderAccess);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+            {},
+            historyBarrier,
+            {},
+            {});
+
+        const std::vector<vk::DescriptorSet> descriptorSets{
+            frame.descriptorSet,
+            materialRegistry->GetTextureTable()->GetDescriptorSet()};
+
+        // Probe pass, trace from every probe and blend the results into the grid before the main
+        // pass reads it
+        if (IsTracingProbes()) {
+            TraceRays(
+                commandBuffer,
+                mProbePipeline.Get(),
+                descriptorSets,
+                cameraOffset,
+                ProbeGrid::RaysPerProbe,
+                mProbeGrid->GetProbeCount());
+
+            const vk::MemoryBarrier probeRayBarrier =
+                vk::MemoryBarrier()
+                    .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                    .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+                vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                probeRayBarrier,
+                {},
+                {});
+            mProbeGrid->Update(commandBuffer);
+        }
+
+        // Resampling passes, pick a light for every primary hit and reuse last frame's and the
+        // neighbors' picks. Each pass reads what the one before it wrote
+        if (IsResampling()) {
+            const vk::MemoryBarrier reservoirBarrier =
+                vk::MemoryBarrier()
+                    .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                    .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+            TraceRays(
+                commandBuffer,
+                mReSTIRInitialPipeline.Get(),
+                descriptorSets,
+                cameraOffset,
+                imageSize.width,
+                imageSize.height);
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+                vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                reservoirBarrier,
+                {},
+                {});
+            const ReSTIRSpatialConstants spatialConstants{
+                .imageSize = glm::uvec2(imageSize.width, imageSize.height),
+                .frameIndex = frameIndex};
+            mReSTIRSpatialPipeline->Dispatch(
+                commandBuffer,
+                mReSTIRSpatialSets[mHistoryIndex],
+                imageSize.width,
+                imageSize.height,
+                &spatialConstants);
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+                {},
+                reservoirBarrier,
+                {},
+                {});
+        }
+
         // Main pass, render to image
         if (mCurrentMode == Renderer::Mode::Realtime || mCurrentTile < TileCount) {
-            commandBuffer.bindPipeline(
-                vk::PipelineBindPoint::eRayTracingKHR,
-                mMainPassPipeline->GetPipelineHandle());
-            commandBuffer.bindDescriptorSets(
-                vk::PipelineBindPoint::eRayTracingKHR,
-                mMainPassPipeline->GetPipelineLayout(),
-                0,
-                mDescriptorSet,
-                nullptr);
-
-            const Pipeline::RayTracingTablesRef& tableRef = mMainPassPipeline->GetTablesRef();
-            commandBuffer.traceRaysKHR(
-                tableRef.rayGen,
-                tableRef.rayMiss,
-                tableRef.rayHit,
-                tableRef.callable,
+            TraceRays(
+                commandBuffer,
+                mMainPassPipeline.Get(),
+                descriptorSets,
+                cameraOffset,
                 imageSize.width,
                 mCurrentMode == Renderer::Mode::Realtime ? imageSize.height
-                                                         : imageSize.height / TileCount,
-                1,
-                mContext->GetDevice()->GetDispatcher());
+                                                         : imageSize.height / TileCount);
 
             if (mCurrentMode == Renderer::Mode::FinalRender) {
                 ++mCurrentTile;
@@ -336,89 +846,131 @@ void Renderer::Render(Camera* camera) {
             }
         }
 
-        // Copy redered image to swapchain
+        // Everything the raygen shader wrote is read by compute passes from here on
+        const vk::MemoryBarrier tracingBarrier =
+            vk::MemoryBarrier()
+                .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            tracingBarrier,
+            {},
+            {});
+
+        if (IsUsingRadianceCache()) {
+            mRadianceCache->Resolve(commandBuffer);
+        }
+        if (IsDenoising()) {
+            mDenoiser->Denoise(commandBuffer, mHistoryIndex);
+        }
+
+        // Display pass, tonemap the accumulated or denoised radiance into the swapchain image
         {
             Texture* currentSwapchainImage = mContext->GetSwapchain()->GetCurrentImage();
-            const vk::ImageSubresourceRange subresourceRange =
-                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
-
             currentSwapchainImage->SetImageLayout(
                 commandBuffer,
                 vk::ImageLayout::eUndefined,
-                vk::ImageLayout::eTransferDstOptimal,
-                vk::PipelineStageFlagBits::eAllCommands,
-                vk::PipelineStageFlagBits::eAllCommands);
-
-            mStorageTexture->SetImageLayout(
-                commandBuffer,
                 vk::ImageLayout::eGeneral,
-                vk::ImageLayout::eTransferSrcOptimal,
                 vk::PipelineStageFlagBits::eAllCommands,
-                vk::PipelineStageFlagBits::eAllCommands);
-
-            vk::ImageCopy imageCopyRegion =
-                vk::ImageCopy()
-                    .setSrcSubresource(
-                        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
-                    .setSrcOffset(vk::Offset3D(0, 0, 0))
-                    .setDstSubresource(
-                        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
-                    .setDstOffset(vk::Offset3D(0, 0, 0))
-                    .setExtent(vk::Extent3D(imageSize.width, imageSize.height, 1));
-
-            commandBuffer.copyImage(
-                mStorageTexture->GetImage(),
-                vk::ImageLayout::eTransferSrcOptimal,
-                currentSwapchainImage->GetImage(),
-                vk::ImageLayout::eTransferDstOptimal,
-                imageCopyRegion);
+                vk::PipelineStageFlagBits::eComputeShader);
 
-            currentSwapchainImage->SetImageLayout(
+            mDisplayPipeline->Dispatch(
                 commandBuffer,
-                vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageLayout::ePresentSrcKHR,
-                vk::PipelineStageFlagBits::eAllCommands,
-                vk::PipelineStageFlagBits::eAllCommands);
+                frame.displayDescriptorSet,
+                imageSize.width,
+                imageSize.height);
 
-            mStorageTexture->SetImageLayout(
+            currentSwapchainImage->SetImageLayout(
                 commandBuffer,
-                vk::ImageLayout::eTransferSrcOptimal,
                 vk::ImageLayout::eGeneral,
-                vk::PipelineStageFlagBits::eAllCommands,
+                vk::ImageLayout::ePresentSrcKHR,
+                vk::PipelineStageFlagBits::eComputeShader,
                 vk::PipelineStageFlagBits::eAllCommands);
         }
-        
+
         VKRT_ASSERT_VK(commandBuffer.end());
     }
 
-    const vk::Queue& queue = mContext->GetDevice()->GetQueue();
-    vk::Fence fence = mContext->GetDevice()->CreateFence();
-
-    std::vector<vk::Semaphore> waitSemaphores{mContext->GetSwapchain()->GetPresentSemaphore()};
-    std::vector<vk::Semaphore> signalSemaphores{mContext->GetSwapchain()->GetRenderSemaphore()};
-    std::vector<vk::PipelineStageFlags> waitStages{vk::PipelineStageFlagBits::eAllCommands};
+    // Anything uploaded while recording (or loaded since the last frame) is waited on by the GPU
+    // through the upload timeline, the CPU never stalls on it
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    const UploadManager::Ticket uploadTicket = uploadManager->Flush();
+
+    const vk::Queue& queue = device->GetQueue();
+    std::vector<vk::Semaphore> waitSemaphores{
+        frame.imageAcquiredSemaphore,
+        uploadManager->GetTimelineSemaphore()};
+    std::vector<uint64_t> waitValues{0, uploadTicket};
+    std::vector<vk::Semaphore> signalSemaphores{frame.renderFinishedSemaphore};
+    std::vector<vk::PipelineStageFlags> waitStages{
+        vk::PipelineStageFlagBits::eAllCommands,
+        vk::PipelineStageFlagBits::eAllCommands};
+    vk::TimelineSemaphoreSubmitInfo timelineInfo =
+        vk::TimelineSemaphoreSubmitInfo().setWaitSemaphoreValues(waitValues);
     VKRT_ASSERT_VK(queue.submit(
         vk::SubmitInfo()
             .setCommandBuffers(commandBuffer)
             .setWaitSemaphores(waitSemaphores)
             .setSignalSemaphores(signalSemaphores)
-            .setWaitDstStageMask(waitStages),
-        fence));
-    VKRT_ASSERT_VK(mContext->GetDevice()->GetLogicalDevice().waitForFences(
-        fence,
-        true,
-        std::numeric_limits<uint64_t>::max()));
+            .setWaitDstStageMask(waitStages)
+            .setPNext(&timelineInfo),
+        frame.fence));
 
-    mContext->GetSwapchain()->Present();
+    mContext->GetSwapchain()->Present(frame.renderFinishedSemaphore);
 
-    mContext->GetDevice()->DestroyFence(fence);
-    mContext->GetDevice()->DestroyCommand(commandBuffer);
+    mCurrentFrame = (mCurrentFrame + 1) % static_cast<uint32_t>(mFrames.size());
+}
+
+void Renderer::TraceRays(
+    vk::CommandBuffer& commandBuffer,
+    Pipeline* pipeline,
+    const std::vector<vk::DescriptorSet>& descriptorSets,
+    uint32_t cameraOffset,
+    uint32_t width,
+    uint32_t height) {
+    commandBuffer.bindPipeline(
+        vk::PipelineBindPoint::eRayTracingKHR,
+        pipeline->GetPipelineHandle());
+    commandBuffer.setRayTracingPipelineStackSizeKHR(
+        pipeline->GetStackSize(),
+        mContext->GetDevice()->GetDispatcher());
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eRayTracingKHR,
+        pipeline->GetPipelineLayout(),
+        0,
+        descriptorSets,
+        cameraOffset);
+
+    const Pipeline::RayTracingTablesRef& tableRef = pipeline->GetTablesRef();
+    commandBuffer.traceRaysKHR(
+        tableRef.rayGen,
+        tableRef.rayMiss,
+        tableRef.rayHit,
+        tableRef.callable,
+        width,
+        height,
+        1,
+        mContext->GetDevice()->GetDispatcher());
 }
 
 void Renderer::OnKeyPressed(int key) {
     if (key == GLFW_KEY_R) {
         mCurrentMode = mCurrentMode == Renderer::Mode::Realtime ? Renderer::Mode::FinalRender
                                                                 : Renderer::Mode::Realtime;
+    } else if (key == GLFW_KEY_B) {
+        mRealtimeSamplerMode = mRealtimeSamplerMode == Renderer::SamplerMode::Sobol
+                                   ? Renderer::SamplerMode::BlueNoise
+                                   : Renderer::SamplerMode::Sobol;
+    } else if (key == GLFW_KEY_N) {
+        mDenoiserEnabled = !mDenoiserEnabled;
+    } else if (key == GLFW_KEY_G) {
+        mProbesEnabled = !mProbesEnabled;
+    } else if (key == GLFW_KEY_H) {
+        mRadianceCacheEnabled = !mRadianceCacheEnabled;
+    } else if (key == GLFW_KEY_L) {
+        mReSTIREnabled = !mReSTIREnabled;
     }
 }
 
@@ -436,6 +988,14 @@ void Renderer::OnRightMouseButtonReleased() {}
 
 Renderer::~Renderer() {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    VKRT_ASSERT_VK(logicalDevice.waitIdle());
+    for (FrameResources& frame : mFrames) {
+        mContext->GetDevice()->DestroyCommand(frame.commandBuffer);
+        mContext->GetDevice()->DestroyFence(frame.fence);
+        logicalDevice.destroySemaphore(frame.imageAcquiredSemaphore);
+        logicalDevice.destroySemaphore(frame.renderFinishedSemaphore);
+    }
+    mFrames.clear();
     logicalDevice.destroyDescriptorPool(mDescriptorPool);
     logicalDevice.destroySampler(mTextureSampler);
     ScopedRefPtr<InputManager> inputManager = mContext->GetWindow()->GetInputManager();
@@ -17,6 +17,16 @@ namespace VKRT {
 INCBIN(GenShader, "raytrace.rgen.spv");
 INCBIN(HitShader, "raytrace.rchit.spv");
 INCBIN(MissShader, "raytrace.rmiss.spv");
+INCBIN(ShadowMissShader, "raytraceShadow.rmiss.spv");
+INCBIN(DisplayShader, "display.comp.spv");
+INCBIN(DenoiseVarianceShader, "denoiseVariance.comp.spv");
+INCBIN(DenoiseAtrousShader, "denoiseAtrous.comp.spv");
+INCBIN(SkyBakeShader, "skyBake.comp.spv");
+INCBIN(ProbeGenShader, "probeTrace.rgen.spv");
+INCBIN(ProbeUpdateShader, "probeUpdate.comp.spv");
+INCBIN(RadianceCacheResolveShader, "radianceCacheResolve.comp.spv");
+INCBIN(ReSTIRInitialShader, "restirInitial.rgen.spv");
+INCBIN(ReSTIRSpatialShader, "restirSpatial.comp.spv");
 }  // namespace VKRT
 #endif
 
@@ -35,6 +45,36 @@ Resource ResourceLoader::Load(const Resource::Id& resourceId) {
         case Resource::Id::MissShader:
             actualId = VKRT_RESOURCE_RAYTRACE_MISS_SHADER;
             break;
+        case Resource::Id::ShadowMissShader:
+            actualId = VKRT_RESOURCE_RAYTRACE_SHADOW_MISS_SHADER;
+            break;
+        case Resource::Id::DisplayShader:
+            actualId = VKRT_RESOURCE_DISPLAY_SHADER;
+            break;
+        case Resource::Id::DenoiseVarianceShader:
+            actualId = VKRT_RESOURCE_DENOISE_VARIANCE_SHADER;
+            break;
+        case Resource::Id::DenoiseAtrousShader:
+            actualId = VKRT_RESOURCE_DENOISE_ATROUS_SHADER;
+            break;
+        case Resource::Id::SkyBakeShader:
+            actualId = VKRT_RESOURCE_SKY_BAKE_SHADER;
+            break;
+        case Resource::Id::ProbeGenShader:
+            actualId = VKRT_RESOURCE_RAYTRACE_PROBE_GEN_SHADER;
+            break;
+        case Resource::Id::ProbeUpdateShader:
+            actualId = VKRT_RESOURCE_PROBE_UPDATE_SHADER;
+            break;
+        case Resource::Id::RadianceCacheResolveShader:
+            actualId = VKRT_RESOURCE_RADIANCE_CACHE_RESOLVE_SHADER;
+            break;
+        case Resource::Id::ReSTIRInitialShader:
+            actualId = VKRT_RESOURCE_RESTIR_INITIAL_SHADER;
+            break;
+        case Resource::Id::ReSTIRSpatialShader:
+            actualId = VKRT_RESOURCE_RESTIR_SPATIAL_SHADER;
+            break;
         default:
             return {nullptr, 0};
     }
@@ -71,6 +111,40 @@ Resource ResourceLoader::Load(const Resource::Id& resourceId) {
         case Resource::Id::MissShader: {
             return Resource{.buffer = gMissShaderData, .size = gMissShaderSize};
         } break;
+        case Resource::Id::ShadowMissShader: {
+            return Resource{.buffer = gShadowMissShaderData, .size = gShadowMissShaderSize};
+        } break;
+        case Resource::Id::DisplayShader: {
+            return Resource{.buffer = gDisplayShaderData, .size = gDisplayShaderSize};
+        } break;
+        case Resource::Id::DenoiseVarianceShader: {
+            return Resource{
+                .buffer = gDenoiseVarianceShaderData,
+                .size = gDenoiseVarianceShaderSize};
+        } break;
+        case Resource::Id::DenoiseAtrousShader: {
+            return Resource{.buffer = gDenoiseAtrousShaderData, .size = gDenoiseAtrousShaderSize};
+        } break;
+        case Resource::Id::SkyBakeShader: {
+            return Resource{.buffer = gSkyBakeShaderData, .size = gSkyBakeShaderSize};
+        } break;
+        case Resource::Id::ProbeGenShader: {
+            return Resource{.buffer = gProbeGenShaderData, .size = gProbeGenShaderSize};
+        } break;
+        case Resource::Id::ProbeUpdateShader: {
+            return Resource{.buffer = gProbeUpdateShaderData, .size = gProbeUpdateShaderSize};
+        } break;
+        case Resource::Id::RadianceCacheResolveShader: {
+            return Resource{
+                .buffer = gRadianceCacheResolveShaderData,
+                .size = gRadianceCacheResolveShaderSize};
+        } break;
+        case Resource::Id::ReSTIRInitialShader: {
+            return Resource{.buffer = gReSTIRInitialShaderData, .size = gReSTIRInitialShaderSize};
+        } break;
+        case Resource::Id::ReSTIRSpatialShader: {
+            return Resource{.buffer = gReSTIRSpatialShaderData, .size = gReSTIRSpatialShaderSize};
+        } break;
         default:
             return {nullptr, 0};
     }
@@ -0,0 +1,165 @@
+#include "SamplerTables.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "UploadManager.h"
+#include "VulkanBuffer.h"
+
+namespace VKRT {
+
+SamplerTables::SamplerTables(ScopedRefPtr<Context> context) : mContext(context) {
+    const std::vector<uint32_t> sobolDirections = GenerateSobolDirections();
+    const std::vector<float> blueNoise = GenerateBlueNoise();
+
+    const vk::DeviceSize sobolSize = sizeof(uint32_t) * sobolDirections.size();
+    const vk::DeviceSize blueNoiseSize = sizeof(float) * blueNoise.size();
+    mBuffer = mContext->GetDevice()->CreateBuffer(
+        sobolSize + blueNoiseSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->UploadBuffer(mBuffer, sobolDirections.data(), sobolSize);
+    uploadManager->UploadBuffer(mBuffer, blueNoise.data(), blueNoiseSize, sobolSize);
+}
+
+std::vector<uint32_t> SamplerTables::GenerateSobolDirections() {
+    // Primitive polynomial degree, coefficients and initial direction numbers for dimensions 2 to
+    // 4, from Joe and Kuo's new-joe-kuo-6.21201
+    struct Polynomial {
+        uint32_t degree;
+        uint32_t coefficients;
+        uint32_t initialNumbers[3];
+    };
+    static constexpr Polynomial polynomials[SobolDimensions - 1]{
+        {1, 0, {1, 0, 0}},
+        {2, 1, {1, 3, 0}},
+        {3, 1, {1, 3, 1}},
+    };
+
+    std::vector<uint32_t> directions(SobolDimensions * SobolBits);
+    // The first dimension is the van der Corput sequence
+    for (uint32_t bit = 0; bit < SobolBits; ++bit) {
+        directions[bit] = 1u << (SobolBits - 1 - bit);
+    }
+    for (uint32_t dimension = 1; dimension < SobolDimensions; ++dimension) {
+        const Polynomial& polynomial = polynomials[dimension - 1];
+        uint32_t* v = &directions[dimension * SobolBits];
+        for (uint32_t bit = 0; bit < polynomial.degree; ++bit) {
+            v[bit] = polynomial.initialNumbers[bit] << (SobolBits - 1 - bit);
+        }
+        for (uint32_t bit = polynomial.degree; bit < SobolBits; ++bit) {
+            v[bit] = v[bit - polynomial.degree] ^ (v[bit - polynomial.degree] >> polynomial.degree);
+            for (uint32_t k = 1; k < polynomial.degree; ++k) {
+                v[bit] ^= ((polynomial.coefficients >> (polynomial.degree - 1 - k)) & 1) *
+                          v[bit - k];
+            }
+        }
+    }
+    return directions;
+}
+
+std::vector<float> SamplerTables::GenerateBlueNoise() {
+    constexpr uint32_t Size = BlueNoiseSize;
+    constexpr uint32_t TexelCount = Size * Size;
+    constexpr float Sigma = 1.5f;
+
+    // Toroidal gaussian, indexed by wrapped offset
+    std::vector<float> kernel(TexelCount);
+    for (uint32_t y = 0; y < Size; ++y) {
+        for (uint32_t x = 0; x < Size; ++x) {
+            const float dx = static_cast<float>(std::min(x, Size - x));
+            const float dy = static_cast<float>(std::min(y, Size - y));
+            kernel[y * Size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * Sigma * Sigma));
+        }
+    }
+
+    std::vector<uint8_t> pattern(TexelCount, 0);
+    std::vector<float> energy(TexelCount, 0.0f);
+    auto splat = [&](uint32_t texel, float sign) {
+        const uint32_t tx = texel % Size;
+        const uint32_t ty = texel / Size;
+        for (uint32_t y = 0; y < Size; ++y) {
+            const uint32_t ky = (y + Size - ty) % Size;
+            for (uint32_t x = 0; x < Size; ++x) {
+                const uint32_t kx = (x + Size - tx) % Size;
+                energy[y * Size + x] += sign * kernel[ky * Size + kx];
+            }
+        }
+    };
+    // Tightest cluster is the densest set texel, largest void the emptiest unset one
+    auto findExtreme = [&](uint8_t value, bool highest) {
+        uint32_t best = 0;
+        float bestEnergy = highest ? -1.0f : std::numeric_limits<float>::max();
+        for (uint32_t texel = 0; texel < TexelCount; ++texel) {
+            if (pattern[texel] != value) {
+                continue;
+            }
+            if (highest ? energy[texel] > bestEnergy : energy[texel] < bestEnergy) {
+                bestEnergy = energy[texel];
+                best = texel;
+            }
+        }
+        return best;
+    };
+
+    // Fixed seed, the mask is the same on every run
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<uint32_t> texelDistribution(0, TexelCount - 1);
+    const uint32_t initialCount = TexelCount / 10;
+    for (uint32_t count = 0; count < initialCount;) {
+        const uint32_t texel = texelDistribution(generator);
+        if (pattern[texel] == 0) {
+            pattern[texel] = 1;
+            splat(texel, 1.0f);
+            ++count;
+        }
+    }
+
+    // Spread the initial points out
+    for (;;) {
+        const uint32_t cluster = findExtreme(1, true);
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        const uint32_t largestVoid = findExtreme(0, false);
+        pattern[largestVoid] = 1;
+        splat(largestVoid, 1.0f);
+        if (largestVoid == cluster) {
+            break;
+        }
+    }
+    const std::vector<uint8_t> initialPattern = pattern;
+    const std::vector<float> initialEnergy = energy;
+
+    std::vector<uint32_t> ranks(TexelCount, 0);
+    // Initial points get the lowest ranks, removed tightest cluster first
+    for (uint32_t rank = initialCount; rank > 0; --rank) {
+        const uint32_t cluster = findExtreme(1, true);
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        ranks[cluster] = rank - 1;
+    }
+    // Every other texel is ranked by filling the largest void
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for (uint32_t rank = initialCount; rank < TexelCount; ++rank) {
+        const uint32_t largestVoid = findExtreme(0, false);
+        pattern[largestVoid] = 1;
+        splat(largestVoid, 1.0f);
+        ranks[largestVoid] = rank;
+    }
+
+    std::vector<float> blueNoise(TexelCount);
+    for (uint32_t texel = 0; texel < TexelCount; ++texel) {
+        blueNoise[texel] = (static_cast<float>(ranks[texel]) + 0.5f) / TexelCount;
+    }
+    return blueNoise;
+}
+
+SamplerTables::~SamplerTables() {}
+
+}  // namespace VKRT
@@ -1,26 +1,95 @@
 #include "Scene.h"
 
+#include <algorithm>
+
 #include "DebugUtils.h"
+#include "UploadManager.h"
 
 #undef MemoryBarrier
 
 namespace VKRT {
 
 Scene::Scene(ScopedRefPtr<Context> context)
-    : mContext(context), mObjects(), mInstanceBuffer(nullptr), mTLASBuffer(nullptr) {
+    : mContext(context),
+      mObjects(),
+      mLights(),
+      mLightVersions(),
+      mLightsBuffer(nullptr),
+      mTLASBuffer(nullptr),
+      mTLAS(nullptr),
+      mTLASAddress(0),
+      mTLASVersion(0),
+      mTopologyDirty(true),
+      mTopologyVersion(0),
+      mInstanceCount(0),
+      mRefitCount(0),
+      mMaxRefitsBeforeRebuild(DefaultMaxRefitsBeforeRebuild) {
     uint64_t dummyData = 0;
-    mDummyTexture = new Texture(
+    ScopedRefPtr<Texture> dummyTexture = new Texture(
         context,
         1,
         1,
         vk::Format::eR8G8B8A8Unorm,
         reinterpret_cast<uint8_t*>(&dummyData),
         4);
+    mMaterialRegistry = new MaterialRegistry(context, dummyTexture);
+    mEmissiveLightTable = new EmissiveLightTable(context);
+    mEnvironment = new Environment(context);
 }
 
 void Scene::AddObject(ScopedRefPtr<Object> object) {
     if (object != nullptr) {
         mObjects.emplace_back(object);
+        for (const ScopedRefPtr<Mesh>& mesh : object->GetModel()->GetMeshes()) {
+            mMaterialRegistry->Register(mesh->GetMaterial());
+        }
+        mTopologyDirty = true;
+    }
+}
+
+void Scene::AddLight(ScopedRefPtr<Light> light) {
+    if (light != nullptr) {
+        mLights.emplace_back(light);
+    }
+}
+
+void Scene::SetEnvironment(ScopedRefPtr<Environment> environment) {
+    if (environment != nullptr) {
+        mEnvironment = environment;
+    }
+}
+
+void Scene::UpdateLights() {
+    std::vector<uint32_t> lightVersions;
+    for (const Light* light : mLights) {
+        lightVersions.push_back(light->GetVersion());
+    }
+    if (mLightsBuffer != nullptr && lightVersions == mLightVersions) {
+        return;
+    }
+    mLightVersions = std::move(lightVersions);
+
+    // Few and small, a fresh buffer per change keeps frames in flight on the one they bound
+    std::vector<Light::Proxy> proxies;
+    for (const Light* light : mLights) {
+        proxies.push_back(light->GetProxy());
+    }
+    const LightsHeader header{
+        .lightCount = static_cast<uint32_t>(proxies.size()),
+        .padding = {0, 0, 0}};
+    const vk::DeviceSize proxiesSize = sizeof(Light::Proxy) * proxies.size();
+    mLightsBuffer = mContext->GetDevice()->CreateBuffer(
+        sizeof(LightsHeader) + proxiesSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    ScopedRefPtr<UploadManager> uploadManager = mContext->GetUploadManager();
+    uploadManager->UploadBuffer(mLightsBuffer, &header, sizeof(LightsHeader));
+    if (!proxies.empty()) {
+        uploadManager->UploadBuffer(
+            mLightsBuffer,
+            proxies.data(),
+            proxiesSize,
+            sizeof(LightsHeader));
     }
 }
 
@@ -33,219 +102,222 @@ std::vector<Mesh::Description> Scene::GetDescriptions() {
     return descriptions;
 }
 
-Scene::SceneMaterials Scene::GetMaterialProxies() {
-    // Gather textures first
-    std::vector<std::pair<ScopedRefPtr<Texture>, int32_t>> textureIndices;
-    textureIndices.push_back({mDummyTexture, 1});
-    int32_t currentTextureIndex = 1;
-    for (const ScopedRefPtr<Object>& object : mObjects) {
-        for (const ScopedRefPtr<Mesh>& mesh : object->GetModel()->GetMeshes()) {
-            const Material* material = mesh->GetMaterial();
-            std::vector<ScopedRefPtr<Texture>> meshTextures{
-                material->GetAlbedoTexture(),
-                material->GetRoughnessTexture()};
-            for (const ScopedRefPtr<Texture>& texture : meshTextures) {
-                if (texture != nullptr) {
-                    auto it = std::find_if(
-                        textureIndices.begin(),
-                        textureIndices.end(),
-                        [&texture](const auto& entry) { return entry.first == texture; });
-
-                    if (it == textureIndices.end()) {
-                        textureIndices.emplace_back(texture, currentTextureIndex);
-                        ++currentTextureIndex;
-                    }
-                }
-            }
-        }
+void Scene::Update(vk::CommandBuffer& commandBuffer, ScopedRefPtr<VulkanBuffer>& instanceBuffer) {
+    // Build every mesh loaded since the last update in a single submission
+    ScopedRefPtr<BLASBuilder> blasBuilder = mContext->GetBLASBuilder();
+    if (blasBuilder->HasPendingBuilds()) {
+        blasBuilder->Flush();
+        mTopologyDirty = true;
     }
 
-    // Gather materials and generate texture indices if applicable
-    std::vector<MaterialProxy> materials;
-    for (const ScopedRefPtr<Object>& object : mObjects) {
-        for (const ScopedRefPtr<Mesh>& mesh : object->GetModel()->GetMeshes()) {
-            const ScopedRefPtr<Material> material = mesh->GetMaterial();
-            MaterialProxy proxy{
-                .albedo = material->GetAlbedo(),
-                .emissive = material->GetEmissive(),
-                .roughness = material->GetRoughness(),
-                .metallic = material->GetMetallic(),
-                .transmission = material->GetTransmission(),
-                .indexOfRefraction = material->GetIndexOfRefraction(),
-                .albedoTextureIndex = -1,
-                .roughnessTextureIndex = -1,
-            };
-            {
-                const ScopedRefPtr<Texture> albedoTexture = material->GetAlbedoTexture();
-                auto albedoIt = std::find_if(
-                    textureIndices.begin(),
-                    textureIndices.end(),
-                    [&albedoTexture](const auto& entry) { return entry.first == albedoTexture; });
-                if (albedoIt != textureIndices.end()) {
-                    proxy.albedoTextureIndex = albedoIt->second;
-                }
-            }
-            {
-                const ScopedRefPtr<Texture> roughnessTexture = material->GetRoughnessTexture();
-                auto roughnessIt = std::find_if(
-                    textureIndices.begin(),
-                    textureIndices.end(),
-                    [&roughnessTexture](const auto& entry) {
-                        return entry.first == roughnessTexture;
-                    });
-                if (roughnessIt != textureIndices.end()) {
-                    proxy.roughnessTextureIndex = roughnessIt->second;
-                }
-            }
-            materials.push_back(proxy);
-        }
+    UpdateLights();
+    mEnvironment->Update(commandBuffer);
+
+    if (mObjects.empty()) {
+        return;
     }
 
-    std::vector<ScopedRefPtr<Texture>> textures;
-    for (const auto& entry : textureIndices) {
-        textures.push_back(entry.first);
+    bool transformsDirty = false;
+    for (const Object* object : mObjects) {
+        transformsDirty = transformsDirty || object->IsTransformDirty();
+    }
+    mEmissiveLightTable->Update(mObjects, mTopologyDirty || transformsDirty);
+    if (!mTopologyDirty && !transformsDirty) {
+        return;
     }
 
-    Scene::SceneMaterials sceneMaterials{
-        .materials = materials,
-        .textures = textures,
-    };
-    return sceneMaterials;
-}
+    const bool isUpdate =
+        !mTopologyDirty && mTLAS && mRefitCount < mMaxRefitsBeforeRebuild;
 
-void Scene::Update(vk::CommandBuffer& commandBuffer) {
-    bool isUpdate = mTLAS;
-    if (!mObjects.empty()) {
-        std::vector<vk::AccelerationStructureInstanceKHR> instances;
-        uint32_t index = 0;
-        for (const Object* object : mObjects) {
-            const glm::mat4& transform = glm::transpose(object->GetTransform());
-            VkTransformMatrixKHR transformMatrix =
-                *(reinterpret_cast<const VkTransformMatrixKHR*>(&transform));
-            for (const Mesh* mesh : object->GetModel()->GetMeshes()) {
-                const bool isRefractive = mesh->GetMaterial()->GetIndexOfRefraction() > 0.0f;
-                instances.emplace_back(
-                    vk::AccelerationStructureInstanceKHR()
-                        .setTransform(transformMatrix)
-                        .setInstanceCustomIndex(index)
-                        .setAccelerationStructureReference(mesh->GetBLASAddress())
-                        .setMask(isRefractive ? Material::RefractiveMask : Material::OpaqueMask)
-                        .setInstanceShaderBindingTableRecordOffset(0)
-                        .setFlags(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable));
-                ++index;
-            }
+    std::vector<vk::AccelerationStructureInstanceKHR> instances;
+    uint32_t index = 0;
+    for (Object* object : mObjects) {
+        const glm::mat4& transform = glm::transpose(object->GetTransform());
+        VkTransformMatrixKHR transformMatrix =
+            *(reinterpret_cast<const VkTransformMatrixKHR*>(&transform));
+        for (const Mesh* mesh : object->GetModel()->GetMeshes()) {
+            // Every material has an index of refraction, only the ones that transmit light are
+            // skipped by opaque-only rays
+            const bool isRefractive = mesh->GetMaterial()->GetTransmission() > 0.0f;
+            instances.emplace_back(
+                vk::AccelerationStructureInstanceKHR()
+                    .setTransform(transformMatrix)
+                    .setInstanceCustomIndex(index)
+                    .setAccelerationStructureReference(mesh->GetBLASAddress())
+                    .setMask(isRefractive ? Material::RefractiveMask : Material::OpaqueMask)
+                    .setInstanceShaderBindingTableRecordOffset(0)
+                    .setFlags(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable));
+            ++index;
         }
+        object->ClearTransformDirty();
+    }
+    const uint32_t instanceCount = static_cast<uint32_t>(instances.size());
+    VKRT_ASSERT(!isUpdate || instanceCount == mInstanceCount);
 
-        const size_t instanceDataSize =
-            instances.size() * sizeof(vk::AccelerationStructureInstanceKHR);
-        mInstanceBuffer = mContext->GetDevice()->CreateBuffer(
+    const size_t instanceDataSize = instances.size() * sizeof(vk::AccelerationStructureInstanceKHR);
+    if (instanceBuffer == nullptr || instanceBuffer->GetBufferSize() < instanceDataSize) {
+        instanceBuffer = mContext->GetDevice()->CreateBuffer(
             instanceDataSize,
             vk::BufferUsageFlagBits::eShaderDeviceAddress |
                 vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
             vk::MemoryAllocateFlagBits::eDeviceAddress);
-        uint8_t* instanceData = mInstanceBuffer->MapBuffer();
-        std::copy_n(reinterpret_cast<uint8_t*>(instances.data()), instanceDataSize, instanceData);
-        mInstanceBuffer->UnmapBuffer();
-        const vk::DeviceAddress instanceBufferAddress = mInstanceBuffer->GetDeviceAddress();
-
-        vk::AccelerationStructureGeometryInstancesDataKHR instancesData =
-            vk::AccelerationStructureGeometryInstancesDataKHR().setArrayOfPointers(false).setData(
-                instanceBufferAddress);
-        vk::AccelerationStructureGeometryKHR accelerationStructureGeometry =
-            vk::AccelerationStructureGeometryKHR()
-                .setGeometryType(vk::GeometryTypeKHR::eInstances)
-                .setFlags(vk::GeometryFlagBitsKHR::eOpaque)
-                .setGeometry(instancesData);
-
-        vk::AccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo =
-            vk::AccelerationStructureBuildGeometryInfoKHR()
-                .setType(vk::AccelerationStructureTypeKHR::eTopLevel)
-                .setFlags(
-                    vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
-                    vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate)
-                .setMode(
-                    isUpdate ? vk::BuildAccelerationStructureModeKHR::eUpdate
-                             : vk::BuildAccelerationStructureModeKHR::eBuild)
-                .setGeometries(accelerationStructureGeometry);
-
-        uint32_t instanceCount = static_cast<uint32_t>(instances.size());
-        vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
-        vk::AccelerationStructureBuildSizesInfoKHR buildSizesInfo =
-            logicalDevice.getAccelerationStructureBuildSizesKHR(
-                vk::AccelerationStructureBuildTypeKHR::eDevice,
-                accelerationStructureBuildGeometryInfo,
-                instanceCount,
-                mContext->GetDevice()->GetDispatcher());
+    }
+    uint8_t* instanceData = instanceBuffer->MapBuffer();
+    std::copy_n(reinterpret_cast<uint8_t*>(instances.data()), instanceDataSize, instanceData);
+    instanceBuffer->UnmapBuffer();
+    const vk::DeviceAddress instanceBufferAddress = instanceBuffer->GetDeviceAddress();
+
+    vk::AccelerationStructureGeometryInstancesDataKHR instancesData =
+        vk::AccelerationStructureGeometryInstancesDataKHR().setArrayOfPointers(false).setData(
+            instanceBufferAddress);
+    vk::AccelerationStructureGeometryKHR accelerationStructureGeometry =
+        vk::AccelerationStructureGeometryKHR()
+            .setGeometryType(vk::GeometryTypeKHR::eInstances)
+            .setFlags(vk::GeometryFlagBitsKHR::eOpaque)
+            .setGeometry(instancesData);
+
+    // Refits must use the same flags as the build they update
+    const vk::BuildAccelerationStructureFlagsKHR buildFlags =
+        vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
+        vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate;
+
+    vk::AccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo =
+        vk::AccelerationStructureBuildGeometryInfoKHR()
+            .setType(vk::AccelerationStructureTypeKHR::eTopLevel)
+            .setFlags(buildFlags)
+            .setGeometries(accelerationStructureGeometry);
+
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    vk::AccelerationStructureBuildSizesInfoKHR buildSizesInfo =
+        logicalDevice.getAccelerationStructureBuildSizesKHR(
+            vk::AccelerationStructureBuildTypeKHR::eDevice,
+            accelerationStructureBuildGeometryInfo,
+            instanceCount,
+            mContext->GetDevice()->GetDispatcher());
 
-        if (!isUpdate) {
-            mTLASBuffer = mContext->GetDevice()->CreateBuffer(
-                buildSizesInfo.accelerationStructureSize,
-                vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
-                    vk::BufferUsageFlagBits::eShaderDeviceAddress,
-                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                vk::MemoryAllocateFlagBits::eDeviceAddress);
-
-            vk::AccelerationStructureCreateInfoKHR accelerationStructureCreateInfo =
-                vk::AccelerationStructureCreateInfoKHR()
-                    .setBuffer(mTLASBuffer->GetBufferHandle())
-                    .setSize(buildSizesInfo.accelerationStructureSize)
-                    .setType(vk::AccelerationStructureTypeKHR::eTopLevel);
-            mTLAS = VKRT_ASSERT_VK(logicalDevice.createAccelerationStructureKHR(
-                accelerationStructureCreateInfo,
+    // Storage is only reallocated when the new instance set doesn't fit in the current one.
+    // Frames still in flight may be tracing against the old storage, so those have to finish
+    // before it can be released, this only happens on topology changes
+    // Over allocated by one alignment unit, suballocated buffer addresses only meet the memory
+    // requirements alignment and not the scratch offset alignment
+    const vk::DeviceSize scratchAlignment = mContext->GetDevice()
+                                                ->GetAccelerationStructureProperties()
+                                                .minAccelerationStructureScratchOffsetAlignment;
+    const vk::DeviceSize scratchSize =
+        std::max(buildSizesInfo.buildScratchSize, buildSizesInfo.updateScratchSize) +
+        scratchAlignment;
+    const bool needsNewTLAS =
+        !isUpdate && (mTLASBuffer == nullptr ||
+                      mTLASBuffer->GetBufferSize() < buildSizesInfo.accelerationStructureSize);
+    const bool needsNewScratch =
+        mScratchBuffer == nullptr || mScratchBuffer->GetBufferSize() < scratchSize;
+    if (mTLAS && (needsNewTLAS || needsNewScratch)) {
+        VKRT_ASSERT_VK(logicalDevice.waitIdle());
+    }
+
+    if (needsNewTLAS) {
+        if (mTLAS) {
+            logicalDevice.destroyAccelerationStructureKHR(
+                mTLAS,
                 nullptr,
-                mContext->GetDevice()->GetDispatcher()));
+                mContext->GetDevice()->GetDispatcher());
         }
 
+        mTLASBuffer = mContext->GetDevice()->CreateBuffer(
+            buildSizesInfo.accelerationStructureSize,
+            vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
+                vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            vk::MemoryAllocateFlagBits::eDeviceAddress);
+
+        vk::AccelerationStructureCreateInfoKHR accelerationStructureCreateInfo =
+            vk::AccelerationStructureCreateInfoKHR()
+                .setBuffer(mTLASBuffer->GetBufferHandle())
+                .setSize(buildSizesInfo.accelerationStructureSize)
+                .setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+        mTLAS = VKRT_ASSERT_VK(logicalDevice.createAccelerationStructureKHR(
+            accelerationStructureCreateInfo,
+            nullptr,
+            mContext->GetDevice()->GetDispatcher()));
+
+        vk::AccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo =
+            vk::AccelerationStructureDeviceAddressInfoKHR().setAccelerationStructure(mTLAS);
+        mTLASAddress = logicalDevice.getAccelerationStructureAddressKHR(
+            accelerationDeviceAddressInfo,
+            mContext->GetDevice()->GetDispatcher());
+        ++mTLASVersion;
+    }
+
+    if (needsNewScratch) {
         mScratchBuffer = mContext->GetDevice()->CreateBuffer(
-            buildSizesInfo.buildScratchSize,
+            scratchSize,
             vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
             vk::MemoryPropertyFlagBits::eDeviceLocal,
             vk::MemoryAllocateFlagBits::eDeviceAddress);
+    }
 
-        vk::AccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo =
-            vk::AccelerationStructureBuildGeometryInfoKHR()
-                .setType(vk::AccelerationStructureTypeKHR::eTopLevel)
-                .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace)
-                .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
-                .setDstAccelerationStructure(mTLAS)
-                .setGeometries(accelerationStructureGeometry)
-                .setScratchData(mScratchBuffer->GetDeviceAddress())
-                .setSrcAccelerationStructure(isUpdate ? mTLAS : nullptr);
-
-        vk::AccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo =
-            vk::AccelerationStructureBuildRangeInfoKHR()
-                .setPrimitiveCount(instanceCount)
-                .setPrimitiveOffset(0)
-                .setFirstVertex(0)
-                .setTransformOffset(0);
-
-        commandBuffer.buildAccelerationStructuresKHR(
-            accelerationBuildGeometryInfo,
-            &accelerationStructureBuildRangeInfo,
-            mContext->GetDevice()->GetDispatcher());
+    vk::AccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo =
+        vk::AccelerationStructureBuildGeometryInfoKHR()
+            .setType(vk::AccelerationStructureTypeKHR::eTopLevel)
+            .setFlags(buildFlags)
+            .setMode(
+                isUpdate ? vk::BuildAccelerationStructureModeKHR::eUpdate
+                         : vk::BuildAccelerationStructureModeKHR::eBuild)
+            .setDstAccelerationStructure(mTLAS)
+            .setSrcAccelerationStructure(isUpdate ? mTLAS : nullptr)
+            .setGeometries(accelerationStructureGeometry)
+            .setScratchData(
+                (mScratchBuffer->GetDeviceAddress() + scratchAlignment - 1) &
+                ~(scratchAlignment - 1));
 
-        vk::MemoryBarrier barrier =
-            vk::MemoryBarrier()
-                .setSrcAccessMask(vk::AccessFlagBits::eAccelerationStructureWriteKHR)
-                .setDstAccessMask(vk::AccessFlagBits::eAccelerationStructureReadKHR);
+    vk::AccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo =
+        vk::AccelerationStructureBuildRangeInfoKHR()
+            .setPrimitiveCount(instanceCount)
+            .setPrimitiveOffset(0)
+            .setFirstVertex(0)
+            .setTransformOffset(0);
 
-        commandBuffer.pipelineBarrier(
+    // Previous frames may still be tracing against the TLAS or building with the same scratch
+    vk::MemoryBarrier buildBarrier =
+        vk::MemoryBarrier()
+            .setSrcAccessMask(vk::AccessFlagBits::eAccelerationStructureWriteKHR)
+            .setDstAccessMask(
+                vk::AccessFlagBits::eAccelerationStructureReadKHR |
+                vk::AccessFlagBits::eAccelerationStructureWriteKHR);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR |
             vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
-            vk::PipelineStageFlagBits::eRayTracingShaderKHR,
-            {},
-            barrier,
-            {},
-            {});
-
-        if (!isUpdate) {
-            vk::AccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo =
-                vk::AccelerationStructureDeviceAddressInfoKHR().setAccelerationStructure(mTLAS);
-            mTLASAddress = logicalDevice.getAccelerationStructureAddressKHR(
-                accelerationDeviceAddressInfo,
-                mContext->GetDevice()->GetDispatcher());
-        }
+        vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+        {},
+        buildBarrier,
+        {},
+        {});
+
+    commandBuffer.buildAccelerationStructuresKHR(
+        accelerationBuildGeometryInfo,
+        &accelerationStructureBuildRangeInfo,
+        mContext->GetDevice()->GetDispatcher());
+
+    vk::MemoryBarrier barrier =
+        vk::MemoryBarrier()
+            .setSrcAccessMask(vk::AccessFlagBits::eAccelerationStructureWriteKHR)
+            .setDstAccessMask(vk::AccessFlagBits::eAccelerationStructureReadKHR);
+
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+        vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+        {},
+        barrier,
+        {},
+        {});
+
+    mRefitCount = isUpdate ? mRefitCount + 1 : 0;
+    mInstanceCount = instanceCount;
+    if (mTopologyDirty) {
+        ++mTopologyVersion;
     }
+    mTopologyDirty = false;
 }
 
 Scene::~Scene() {
@@ -13,6 +13,13 @@ Swapchain::Swapchain(ScopedRefPtr<Context> context) : mContext(context), mCurren
     Device::SwapchainCapabilities swapchainCapabilities =
         mContext->GetDevice()->GetSwapchainCapabilities(mContext->GetSurface());
 
+    // The display pass writes the final color straight into the swapchain image, so the format
+    // has to support storage. sRGB formats usually don't, the display pass encodes by hand
+    auto supportsStorage = [this](const vk::SurfaceFormatKHR& format) {
+        return static_cast<bool>(
+            mContext->GetDevice()->GetFormatProperties(format.format).optimalTilingFeatures &
+            vk::FormatFeatureFlagBits::eStorageImage);
+    };
     vk::SurfaceFormatKHR surfaceFormat(
         vk::Format::eB8G8R8A8Unorm,
         vk::ColorSpaceKHR::eSrgbNonlinear);
@@ -21,8 +28,13 @@ Swapchain::Swapchain(ScopedRefPtr<Context> context) : mContext(context), mCurren
             swapchainCapabilities.supportedFormats.begin(),
             swapchainCapabilities.supportedFormats.end(),
             surfaceFormat) != swapchainCapabilities.supportedFormats.end();
-    if (!supportsPreferredFormat) {
-        surfaceFormat = swapchainCapabilities.supportedFormats.front();
+    if (!supportsPreferredFormat || !supportsStorage(surfaceFormat)) {
+        const auto storageFormat = std::find_if(
+            swapchainCapabilities.supportedFormats.begin(),
+            swapchainCapabilities.supportedFormats.end(),
+            supportsStorage);
+        VKRT_ASSERT(storageFormat != swapchainCapabilities.supportedFormats.end());
+        surfaceFormat = *storageFormat;
     }
 
     vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
@@ -52,6 +64,8 @@ Swapchain::Swapchain(ScopedRefPtr<Context> context) : mContext(context), mCurren
                 surfaceCaps.maxImageExtent.height));
     }
 
+    VKRT_ASSERT(surfaceCaps.supportedUsageFlags & vk::ImageUsageFlagBits::eStorage);
+
     uint32_t imageCount = surfaceCaps.minImageCount + 1;
     if (surfaceCaps.maxImageCount != 0 && imageCount > surfaceCaps.maxImageCount) {
         imageCount = surfaceCaps.maxImageCount;
@@ -66,7 +80,7 @@ Swapchain::Swapchain(ScopedRefPtr<Context> context) : mContext(context), mCurren
             .setImageExtent(surfaceExtent)
             .setImageArrayLayers(1)
             .setImageUsage(
-                vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst)
+                vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eStorage)
             .setImageSharingMode(vk::SharingMode::eExclusive)
             .setPreTransform(surfaceCaps.currentTransform)
             .setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
@@ -87,32 +101,27 @@ Swapchain::Swapchain(ScopedRefPtr<Context> context) : mContext(context), mCurren
             new Texture(mContext, surfaceExtent.width, surfaceExtent.height, mFormat, {}, image);
         mImages.emplace_back(texture);
     }
-
-    mPresentSemaphore = VKRT_ASSERT_VK(logicalDevice.createSemaphore(vk::SemaphoreCreateInfo{}));
-    mRenderSemaphore = VKRT_ASSERT_VK(logicalDevice.createSemaphore(vk::SemaphoreCreateInfo{}));
 }
 
-void Swapchain::AcquireNextImage() {
+void Swapchain::AcquireNextImage(const vk::Semaphore& acquiredSemaphore) {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
     mCurrentImageIndex = VKRT_ASSERT_VK(logicalDevice.acquireNextImageKHR(
         mSwapchainHandle,
         std::numeric_limits<uint64_t>::max(),
-        mPresentSemaphore));
+        acquiredSemaphore));
 }
 
-void Swapchain::Present() {
+void Swapchain::Present(const vk::Semaphore& renderFinishedSemaphore) {
     vk::PresentInfoKHR presentInfo = vk::PresentInfoKHR()
                                          .setSwapchains(mSwapchainHandle)
                                          .setImageIndices(mCurrentImageIndex)
-                                         .setWaitSemaphores(mRenderSemaphore);
+                                         .setWaitSemaphores(renderFinishedSemaphore);
     const vk::Queue& queue = mContext->GetDevice()->GetQueue();
     VKRT_ASSERT_VK(queue.presentKHR(presentInfo));
 }
 
 Swapchain::~Swapchain() {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
-    logicalDevice.destroySemaphore(mRenderSemaphore);
-    logicalDevice.destroySemaphore(mPresentSemaphore);
     mImages.clear();
     logicalDevice.destroySwapchainKHR(mSwapchainHandle);
 }
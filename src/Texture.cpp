@@ -1,8 +1,10 @@
 #include "Texture.h"
 
+#include <array>
+
 #include "DebugUtils.h"
 #include "Device.h"
-#include "VulkanBuffer.h"
+#include "UploadManager.h"
 
 namespace VKRT {
 
@@ -38,11 +40,11 @@ Texture::Texture(
 
         mImage = VKRT_ASSERT_VK(logicalDevice.createImage(imageCreateInfo));
 
-        vk::MemoryRequirements imageMemReq = logicalDevice.getImageMemoryRequirements(mImage);
-        mMemory = mContext->GetDevice()->AllocateMemory(
-            vk::MemoryPropertyFlagBits::eDeviceLocal,
-            imageMemReq);
-        VKRT_ASSERT_VK(logicalDevice.bindImageMemory(mImage, mMemory, 0));
+        mAllocation = mContext->GetDevice()->AllocateImageMemory(
+            mImage,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+        VKRT_ASSERT_VK(
+            logicalDevice.bindImageMemory(mImage, mAllocation.memory, mAllocation.offset));
     }
 
     vk::ImageViewCreateInfo imageViewCreateInfo =
@@ -82,51 +84,37 @@ Texture::Texture(
           height,
           format,
           vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled) {
-    ScopedRefPtr<VulkanBuffer> stagingBuffer = VulkanBuffer::Create(
-        mContext,
-        bufferSize,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    uint8_t* stagingData = stagingBuffer->MapBuffer();
-    std::copy_n(buffer, bufferSize, stagingData);
-    stagingBuffer->UnmapBuffer();
-
-    vk::CommandBuffer commandBuffer = mContext->GetDevice()->CreateCommandBuffer();
-    VKRT_ASSERT_VK(commandBuffer.begin(vk::CommandBufferBeginInfo{}));
-
-    const vk::ImageSubresourceRange subresourceRange =
-        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    // Batched with every other pending upload, the renderer waits on the upload timeline before
+    // sampling it
+    mContext->GetUploadManager()->UploadTexture(this, buffer, bufferSize);
+}
 
-    SetImageLayout(
+ScopedRefPtr<Texture> Texture::CreateStorageImage(
+    ScopedRefPtr<Context> context,
+    vk::CommandBuffer& commandBuffer,
+    uint32_t width,
+    uint32_t height,
+    vk::Format format,
+    vk::ImageUsageFlags additionalUsageFlags) {
+    ScopedRefPtr<Texture> texture = new Texture(
+        context,
+        width,
+        height,
+        format,
+        additionalUsageFlags | vk::ImageUsageFlagBits::eStorage |
+            vk::ImageUsageFlagBits::eTransferDst);
+    texture->SetImageLayout(
         commandBuffer,
         vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eTransferDstOptimal,
+        vk::ImageLayout::eGeneral,
         vk::PipelineStageFlagBits::eAllCommands,
         vk::PipelineStageFlagBits::eAllCommands);
-
-    vk::BufferImageCopy imageCopy =
-        vk::BufferImageCopy()
-            .setImageSubresource(
-                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
-            .setImageExtent(vk::Extent3D{width, height, 1})
-            .setBufferOffset(0);
-
-    commandBuffer.copyBufferToImage(
-        stagingBuffer->GetBufferHandle(),
-        mImage,
-        vk::ImageLayout::eTransferDstOptimal,
-        imageCopy);
-
-    SetImageLayout(
-        commandBuffer,
-        vk::ImageLayout::eTransferDstOptimal,
-        vk::ImageLayout::eShaderReadOnlyOptimal,
-        vk::PipelineStageFlagBits::eAllCommands,
-        vk::PipelineStageFlagBits::eAllCommands);
-
-    VKRT_ASSERT_VK(commandBuffer.end());
-    mContext->GetDevice()->SubmitCommandAndFlush(commandBuffer);
-    mContext->GetDevice()->DestroyCommand(commandBuffer);
+    commandBuffer.clearColorImage(
+        texture->GetImage(),
+        vk::ImageLayout::eGeneral,
+        vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}),
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+    return texture;
 }
 
 void Texture::SetImageLayout(
@@ -159,6 +147,9 @@ void Texture::SetImageLayout(
         case vk::ImageLayout::eTransferDstOptimal:
             imageBarrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
             break;
+        case vk::ImageLayout::eGeneral:
+            imageBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
+            break;
     }
 
     switch (newLayout) {
@@ -171,6 +162,10 @@ void Texture::SetImageLayout(
         case vk::ImageLayout::eColorAttachmentOptimal:
             imageBarrier.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
             break;
+        case vk::ImageLayout::eGeneral:
+            imageBarrier.setDstAccessMask(
+                vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+            break;
     }
 
     commandBuffer.pipelineBarrier(srcStageMask, dstStageMask, {}, {}, {}, imageBarrier);
@@ -181,7 +176,7 @@ Texture::~Texture() {
     logicalDevice.destroyImageView(mImageView);
     if (ownsImage) {
         logicalDevice.destroyImage(mImage);
-        logicalDevice.freeMemory(mMemory);
+        mContext->GetDevice()->FreeMemory(mAllocation);
     }
 }
 
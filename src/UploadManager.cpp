@@ -0,0 +1,380 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Context.h"
+#include "DebugUtils.h"
+#include "Texture.h"
+#include "VulkanBuffer.h"
+
+namespace VKRT {
+
+namespace {
+vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+UploadManager::UploadManager(ScopedRefPtr<Context> context)
+    : mContext(context),
+      mUsesTransferQueue(false),
+      mTimelineValue(0),
+      mLastSubmittedTicket(0),
+      mStagingRing(nullptr),
+      mStagingHead(0),
+      mBatch(),
+      mInFlightBatches() {
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::Device& logicalDevice = device->GetLogicalDevice();
+    mUsesTransferQueue = device->HasDedicatedTransferQueue();
+
+    mTransferCommandPool = VKRT_ASSERT_VK(logicalDevice.createCommandPool(
+        vk::CommandPoolCreateInfo()
+            .setQueueFamilyIndex(device->GetTransferQueueFamilyIndex())
+            .setFlags(vk::CommandPoolCreateFlagBits::eTransient)));
+    if (mUsesTransferQueue) {
+        mAcquireCommandPool = VKRT_ASSERT_VK(logicalDevice.createCommandPool(
+            vk::CommandPoolCreateInfo()
+                .setQueueFamilyIndex(device->GetGraphicsQueueFamilyIndex())
+                .setFlags(vk::CommandPoolCreateFlagBits::eTransient)));
+    }
+
+    vk::SemaphoreTypeCreateInfo semaphoreTypeInfo =
+        vk::SemaphoreTypeCreateInfo().setSemaphoreType(vk::SemaphoreType::eTimeline).setInitialValue(
+            0);
+    mTimelineSemaphore = VKRT_ASSERT_VK(
+        logicalDevice.createSemaphore(vk::SemaphoreCreateInfo().setPNext(&semaphoreTypeInfo)));
+
+    // Copy offsets into images have to be a multiple of the texel size, 16 covers every format
+    // we upload
+    mStagingAlignment = std::max<vk::DeviceSize>(
+        16,
+        device->GetDeviceProperties().limits.optimalBufferCopyOffsetAlignment);
+    mStagingRing = device->CreateBuffer(
+        StagingRingSize,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+UploadManager::StagingRegion UploadManager::AllocateStaging(vk::DeviceSize size) {
+    // Uploads that would take a large share of the ring get their own staging buffer instead of
+    // draining it
+    if (size > StagingRingSize / 2) {
+        ScopedRefPtr<VulkanBuffer> stagingBuffer = mContext->GetDevice()->CreateBuffer(
+            size,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        mBatch.buffers.push_back(stagingBuffer);
+        return StagingRegion{
+            .buffer = stagingBuffer->GetBufferHandle(),
+            .offset = 0,
+            .data = stagingBuffer->MapBuffer(),
+        };
+    }
+
+    while (true) {
+        RetireCompletedBatches();
+
+        // The live part of the ring starts at the oldest batch that still has staging data
+        const auto oldestBatch = std::find_if(
+            mInFlightBatches.begin(),
+            mInFlightBatches.end(),
+            [](const Batch& batch) { return batch.hasStagingData; });
+        const bool ringEmpty = oldestBatch == mInFlightBatches.end() && !mBatch.hasStagingData;
+        const vk::DeviceSize tail = oldestBatch != mInFlightBatches.end()
+                                        ? oldestBatch->stagingBegin
+                                        : mBatch.stagingBegin;
+
+        // Sizes below tail are strict so head never catches up with tail while data is live
+        vk::DeviceSize offset = AlignUp(mStagingHead, mStagingAlignment);
+        bool fits = false;
+        if (ringEmpty) {
+            offset = 0;
+            fits = true;
+        } else if (mStagingHead >= tail) {
+            if (offset + size <= StagingRingSize) {
+                fits = true;
+            } else if (size < tail) {
+                offset = 0;
+                fits = true;
+            }
+        } else {
+            fits = offset + size < tail;
+        }
+
+        if (fits) {
+            if (!mBatch.hasStagingData) {
+                mBatch.hasStagingData = true;
+                mBatch.stagingBegin = offset;
+            }
+            mStagingHead = offset + size;
+            mBatch.stagingEnd = mStagingHead;
+            return StagingRegion{
+                .buffer = mStagingRing->GetBufferHandle(),
+                .offset = offset,
+                .data = mStagingRing->MapBuffer() + offset,
+            };
+        }
+
+        // Out of space, submit what is pending and wait for the oldest batch to free its range
+        if (mBatch.hasStagingData) {
+            Flush();
+        } else {
+            Wait(oldestBatch->ticket);
+        }
+    }
+}
+
+void UploadManager::BeginBatch() {
+    if (mBatch.transferCommandBuffer) {
+        return;
+    }
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    mBatch.transferCommandBuffer =
+        VKRT_ASSERT_VK(logicalDevice.allocateCommandBuffers(
+                           vk::CommandBufferAllocateInfo()
+                               .setCommandBufferCount(1)
+                               .setCommandPool(mTransferCommandPool)
+                               .setLevel(vk::CommandBufferLevel::ePrimary)))[0];
+    VKRT_ASSERT_VK(mBatch.transferCommandBuffer.begin(
+        vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)));
+}
+
+void UploadManager::UploadBuffer(
+    ScopedRefPtr<VulkanBuffer> destination,
+    const void* data,
+    vk::DeviceSize size,
+    vk::DeviceSize destinationOffset) {
+    if (size == 0) {
+        return;
+    }
+    const StagingRegion staging = AllocateStaging(size);
+    std::copy_n(static_cast<const uint8_t*>(data), size, staging.data);
+
+    BeginBatch();
+    mBatch.transferCommandBuffer.copyBuffer(
+        staging.buffer,
+        destination->GetBufferHandle(),
+        vk::BufferCopy()
+            .setSrcOffset(staging.offset)
+            .setDstOffset(destinationOffset)
+            .setSize(size));
+
+    // Read by acceleration structure builds and ray tracing shaders
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::BufferMemoryBarrier barrier = vk::BufferMemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                          .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+                                          .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                          .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                          .setBuffer(destination->GetBufferHandle())
+                                          .setOffset(destinationOffset)
+                                          .setSize(size);
+    if (mUsesTransferQueue) {
+        // Release here, the matching acquire is recorded on the graphics queue at flush
+        barrier.setSrcQueueFamilyIndex(device->GetTransferQueueFamilyIndex())
+            .setDstQueueFamilyIndex(device->GetGraphicsQueueFamilyIndex());
+        mBatch.transferCommandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eBottomOfPipe,
+            {},
+            {},
+            vk::BufferMemoryBarrier(barrier).setDstAccessMask({}),
+            {});
+        mBatch.bufferAcquires.push_back(barrier.setSrcAccessMask({}));
+    } else {
+        mBatch.transferCommandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR |
+                vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+            {},
+            {},
+            barrier,
+            {});
+    }
+    mBatch.buffers.push_back(destination);
+}
+
+void UploadManager::UploadTexture(
+    ScopedRefPtr<Texture> texture,
+    const void* data,
+    vk::DeviceSize size) {
+    const StagingRegion staging = AllocateStaging(size);
+    std::copy_n(static_cast<const uint8_t*>(data), size, staging.data);
+
+    BeginBatch();
+    const vk::ImageSubresourceRange subresourceRange =
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, texture->GetLayers());
+    mBatch.transferCommandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        {},
+        {},
+        vk::ImageMemoryBarrier()
+            .setSrcAccessMask({})
+            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setOldLayout(vk::ImageLayout::eUndefined)
+            .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(texture->GetImage())
+            .setSubresourceRange(subresourceRange));
+
+    mBatch.transferCommandBuffer.copyBufferToImage(
+        staging.buffer,
+        texture->GetImage(),
+        vk::ImageLayout::eTransferDstOptimal,
+        vk::BufferImageCopy()
+            .setBufferOffset(staging.offset)
+            .setImageSubresource(vk::ImageSubresourceLayers(
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                0,
+                texture->GetLayers()))
+            .setImageExtent(vk::Extent3D{texture->GetWidth(), texture->GetHeight(), 1}));
+
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
+                                         .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                         .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+                                         .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                                         .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                                         .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                         .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                         .setImage(texture->GetImage())
+                                         .setSubresourceRange(subresourceRange);
+    if (mUsesTransferQueue) {
+        // The layout transition is part of the release/acquire pair, both sides spell it out
+        barrier.setSrcQueueFamilyIndex(device->GetTransferQueueFamilyIndex())
+            .setDstQueueFamilyIndex(device->GetGraphicsQueueFamilyIndex());
+        mBatch.transferCommandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eBottomOfPipe,
+            {},
+            {},
+            {},
+            vk::ImageMemoryBarrier(barrier).setDstAccessMask({}));
+        mBatch.imageAcquires.push_back(barrier.setSrcAccessMask({}));
+    } else {
+        mBatch.transferCommandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+            {},
+            {},
+            {},
+            barrier);
+    }
+    mBatch.textures.push_back(texture);
+}
+
+UploadManager::Ticket UploadManager::Flush() {
+    if (!mBatch.transferCommandBuffer) {
+        return mLastSubmittedTicket;
+    }
+
+    ScopedRefPtr<Device> device = mContext->GetDevice();
+    vk::Device& logicalDevice = device->GetLogicalDevice();
+    VKRT_ASSERT_VK(mBatch.transferCommandBuffer.end());
+
+    const uint64_t transferValue = ++mTimelineValue;
+    {
+        vk::TimelineSemaphoreSubmitInfo timelineInfo =
+            vk::TimelineSemaphoreSubmitInfo().setSignalSemaphoreValues(transferValue);
+        const vk::Queue& queue = mUsesTransferQueue ? device->GetTransferQueue() : device->GetQueue();
+        VKRT_ASSERT_VK(queue.submit(
+            vk::SubmitInfo()
+                .setCommandBuffers(mBatch.transferCommandBuffer)
+                .setSignalSemaphores(mTimelineSemaphore)
+                .setPNext(&timelineInfo)));
+    }
+    mBatch.ticket = transferValue;
+
+    // Ownership moves to the graphics family in a second, tiny submission that waits on the copies
+    if (mUsesTransferQueue) {
+        mBatch.acquireCommandBuffer =
+            VKRT_ASSERT_VK(logicalDevice.allocateCommandBuffers(
+                               vk::CommandBufferAllocateInfo()
+                                   .setCommandBufferCount(1)
+                                   .setCommandPool(mAcquireCommandPool)
+                                   .setLevel(vk::CommandBufferLevel::ePrimary)))[0];
+        VKRT_ASSERT_VK(mBatch.acquireCommandBuffer.begin(
+            vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)));
+        mBatch.acquireCommandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR |
+                vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+            {},
+            {},
+            mBatch.bufferAcquires,
+            mBatch.imageAcquires);
+        VKRT_ASSERT_VK(mBatch.acquireCommandBuffer.end());
+
+        const uint64_t acquireValue = ++mTimelineValue;
+        const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+        vk::TimelineSemaphoreSubmitInfo timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+                                                           .setWaitSemaphoreValues(transferValue)
+                                                           .setSignalSemaphoreValues(acquireValue);
+        VKRT_ASSERT_VK(device->GetQueue().submit(
+            vk::SubmitInfo()
+                .setCommandBuffers(mBatch.acquireCommandBuffer)
+                .setWaitSemaphores(mTimelineSemaphore)
+                .setWaitDstStageMask(waitStage)
+                .setSignalSemaphores(mTimelineSemaphore)
+                .setPNext(&timelineInfo)));
+        mBatch.ticket = acquireValue;
+    }
+
+    mBatch.bufferAcquires.clear();
+    mBatch.imageAcquires.clear();
+    mLastSubmittedTicket = mBatch.ticket;
+    mInFlightBatches.push_back(std::move(mBatch));
+    mBatch = Batch{};
+    return mLastSubmittedTicket;
+}
+
+bool UploadManager::IsComplete(Ticket ticket) {
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    return VKRT_ASSERT_VK(logicalDevice.getSemaphoreCounterValue(mTimelineSemaphore)) >= ticket;
+}
+
+void UploadManager::Wait(Ticket ticket) {
+    VKRT_ASSERT(ticket <= mLastSubmittedTicket);
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    VKRT_ASSERT_VK(logicalDevice.waitSemaphores(
+        vk::SemaphoreWaitInfo().setSemaphores(mTimelineSemaphore).setValues(ticket),
+        (std::numeric_limits<uint64_t>::max)()));
+    RetireCompletedBatches();
+}
+
+void UploadManager::RetireCompletedBatches() {
+    if (mInFlightBatches.empty()) {
+        return;
+    }
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    const uint64_t completedValue =
+        VKRT_ASSERT_VK(logicalDevice.getSemaphoreCounterValue(mTimelineSemaphore));
+    while (!mInFlightBatches.empty() && mInFlightBatches.front().ticket <= completedValue) {
+        Batch& batch = mInFlightBatches.front();
+        logicalDevice.freeCommandBuffers(mTransferCommandPool, batch.transferCommandBuffer);
+        if (batch.acquireCommandBuffer) {
+            logicalDevice.freeCommandBuffers(mAcquireCommandPool, batch.acquireCommandBuffer);
+        }
+        mInFlightBatches.pop_front();
+    }
+}
+
+UploadManager::~UploadManager() {
+    Flush();
+    Wait(mLastSubmittedTicket);
+
+    vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
+    logicalDevice.destroySemaphore(mTimelineSemaphore);
+    logicalDevice.destroyCommandPool(mTransferCommandPool);
+    if (mAcquireCommandPool) {
+        logicalDevice.destroyCommandPool(mAcquireCommandPool);
+    }
+}
+
+}  // namespace VKRT
@@ -10,7 +10,8 @@ ScopedRefPtr<VulkanBuffer> VulkanBuffer::Create(
     const vk::DeviceSize& size,
     const vk::BufferUsageFlags& usageFlags,
     const vk::MemoryPropertyFlags& memoryFlags,
-    const vk::MemoryAllocateFlags& memoryAllocateFlags) {
+    const vk::MemoryAllocateFlags& memoryAllocateFlags,
+    const vk::MemoryPropertyFlags& preferredMemoryFlags) {
     const vk::Device& logicalDevice = context->GetDevice()->GetLogicalDevice();
     const vk::BufferCreateInfo bufferCreateInfo = vk::BufferCreateInfo()
                                                       .setSize(size)
@@ -18,40 +19,47 @@ ScopedRefPtr<VulkanBuffer> VulkanBuffer::Create(
                                                       .setSharingMode(vk::SharingMode::eExclusive);
     const vk::Buffer bufferHandle = VKRT_ASSERT_VK(logicalDevice.createBuffer(bufferCreateInfo));
 
-    const vk::MemoryRequirements memoryRequirements =
-        logicalDevice.getBufferMemoryRequirements(bufferHandle);
-    const vk::DeviceMemory memoryHandle =
-        context->GetDevice()->AllocateMemory(memoryFlags, memoryRequirements, memoryAllocateFlags);
+    // Suballocations are only aligned to the memory requirements, shader binding table addresses
+    // also have to be multiples of the group base alignment
+    const vk::DeviceSize minAlignment =
+        usageFlags & vk::BufferUsageFlagBits::eShaderBindingTableKHR
+            ? context->GetDevice()->GetRayTracingProperties().shaderGroupBaseAlignment
+            : 1;
+    const MemoryAllocation allocation = context->GetDevice()->AllocateBufferMemory(
+        bufferHandle,
+        memoryFlags,
+        memoryAllocateFlags,
+        preferredMemoryFlags,
+        minAlignment);
 
-    VKRT_ASSERT_VK(logicalDevice.bindBufferMemory(bufferHandle, memoryHandle, 0));
+    VKRT_ASSERT_VK(
+        logicalDevice.bindBufferMemory(bufferHandle, allocation.memory, allocation.offset));
 
     const vk::DescriptorBufferInfo bufferInfo =
         vk::DescriptorBufferInfo().setBuffer(bufferHandle).setOffset(0).setRange(size);
 
-    return new VulkanBuffer(context, size, bufferHandle, memoryHandle, bufferInfo);
+    return new VulkanBuffer(context, size, bufferHandle, allocation, bufferInfo);
 }
 
 VulkanBuffer::VulkanBuffer(
     ScopedRefPtr<Context> context,
     vk::DeviceSize size,
     vk::Buffer bufferHandle,
-    vk::DeviceMemory memoryHandle,
+    MemoryAllocation allocation,
     vk::DescriptorBufferInfo descriptorInfo)
     : mContext(context),
       mSize(size),
       mBufferHandle(bufferHandle),
-      mMemoryHandle(memoryHandle),
+      mAllocation(allocation),
       mDescriptorInfo(descriptorInfo) {}
 
+// Host visible memory is persistently mapped by the allocator
 uint8_t* VulkanBuffer::MapBuffer() {
-    const vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
-    return static_cast<uint8_t*>(VKRT_ASSERT_VK(logicalDevice.mapMemory(mMemoryHandle, 0, mSize)));
+    VKRT_ASSERT(mAllocation.mappedData != nullptr);
+    return mAllocation.mappedData;
 }
 
-void VulkanBuffer::UnmapBuffer() {
-    const vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
-    logicalDevice.unmapMemory(mMemoryHandle);
-}
+void VulkanBuffer::UnmapBuffer() {}
 
 vk::DeviceAddress VulkanBuffer::GetDeviceAddress() {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
@@ -63,7 +71,7 @@ vk::DeviceAddress VulkanBuffer::GetDeviceAddress() {
 VulkanBuffer::~VulkanBuffer() {
     vk::Device& logicalDevice = mContext->GetDevice()->GetLogicalDevice();
     logicalDevice.destroyBuffer(mBufferHandle);
-    logicalDevice.freeMemory(mMemoryHandle);
+    mContext->GetDevice()->FreeMemory(mAllocation);
 }
 
 }  // namespace VKRT
\ No newline at end of file
@@ -61,7 +61,11 @@ int main() {
             }
 
             {
-                ScopedRefPtr<Model> dragon = Model::Load(context, "./assets/DragonAttenuation.glb");
+                ScopedRefPtr<Model> dragon = Model::Load(
+                    context,
+                    "./assets/DragonAttenuation.glb",
+                    Mesh::BuildPolicy::FastTrace,
+                    true);
                 std::for_each(
                     dragon->GetMeshes().begin(),
                     dragon->GetMeshes().end(),
@@ -74,7 +78,11 @@ int main() {
             }
 
             {
-                ScopedRefPtr<Model> mesh = Model::Load(context, "./assets/venus.gltf");
+                ScopedRefPtr<Model> mesh = Model::Load(
+                    context,
+                    "./assets/venus.gltf",
+                    Mesh::BuildPolicy::FastTrace,
+                    true);
                 std::for_each(mesh->GetMeshes().begin(), mesh->GetMeshes().end(), [](Mesh* mesh) {
                     mesh->GetMaterial()->SetAlbedo(glm::vec3(0.9f, 0.87f, 0.8f));
                 });
@@ -118,6 +126,10 @@ int main() {
             camera->SetRotation(glm::vec3(0.0f, -90.0f, 0.0f));
 
             ScopedRefPtr<Renderer> renderer = new Renderer(context, scene);
+            // Probes just inside the walls of the box
+            renderer->GetProbeGrid()->SetVolume(
+                glm::vec3(0.0f, 5.0f, 0.0f),
+                glm::vec3(14.0f, 9.0f, 14.0f));
             Timer timer;
             double elapsedSeconds = 0.0;
             double totalSeconds = 0.0;